@@ -58,7 +58,6 @@ int main()
 		    case 'W':
 			    {
 				    /* Read the file */
-				    string text;
 				    string path;
 				    std::cout << "Please enter the full path to the text file you wish to send to the blockchain:" << std::endl;
 				    std::cin >> path;
@@ -74,20 +73,13 @@ int main()
 	                    throw std::runtime_error("The named path does not refer to a regular file");
                     }
 
-				    std::stringstream sstr;
-				    fs::ifstream fileStream(filePath, ios::in);
-				    sstr << fileStream.rdbuf();
-				    text = sstr.str();
-
-
-				    /* Compress the data */
-				    HuffmanCoding::TransformCharDomain(text);
+				    /* Compress the data while reading it */
 				    std::cout << std::endl << "Your text has been converted into:" << std::endl;
-				    std::cout << text << std::endl;
-				    Data originalData = Data(text.begin(), text.end());
-				    DataBits compressedData = HuffmanCoding::Compress(originalData, Utilities::HuffCode);
+				    CompressedFile compressedFile = CompressFile(path, LoadCompressionBackends(), std::cout);
+				    std::cout << std::endl;
+				    const DataBits& compressedData = compressedFile.bits;
 
-                    std::cout << "[INFO] Original data size: " << originalData.size() << " bytes" << std::endl;
+                    std::cout << "[INFO] Original data size: " << compressedFile.nChars << " bytes" << std::endl;
                     std::cout << "[INFO] Compressed data size: " << compressedData.size() / 8.0 << " bytes" << std::endl; 
 
 				    /* Embed the data into a transaction chain */
@@ -147,10 +139,11 @@ int main()
 				    vector<TransactionChain> chain = ReadTransactions(BeginTx, EndTx);
                     std::cout << "[INFO] Successfully extracted " << chain.size() << " message(s)!" << std::endl;
 
+				    BackendList backends = LoadCompressionBackends();
 				    for(vector<TransactionChain>::const_iterator it = chain.begin(); it != chain.end(); it++)
 				    {
 					    DataBits compressedData = ExtractData(*it);
-					    Data uncompressedData = HuffmanCoding::Decompress(compressedData, Utilities::HuffCode);
+					    Data uncompressedData = DecompressMessage(compressedData, backends);
 
 					    std::cout << "[INFO] Message (" << uncompressedData.size() << " characters)" << std::endl;
 					    std::cout << string(uncompressedData.begin(), uncompressedData.end()) << std::endl;
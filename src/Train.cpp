@@ -0,0 +1,147 @@
+/**
+ * Training executable. Counts the characters of a corpus directory,
+ * builds a new Huffman code and frequency tables from them and
+ * reports how the new code compares to the current one. It also
+ * converts an archived Huffman code into a binary code table.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "lib/bms/Serialization.h"
+#include "lib/bms/Training.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using std::string;
+using std::vector;
+
+namespace fs = boost::filesystem;
+
+
+/**
+ * Converts an archived Huffman code into a binary code table.
+ * @param argc Number of arguments.
+ * @param argv Arguments, i.e. the archive, the table and optionally a maximum code length.
+ * @return Exit code.
+ */
+static int ConvertCode(int argc, char* argv[])
+{
+	try
+	{
+		unsigned int nMaxBits = (argc == 5) ? std::stoul(argv[4]) : 0;
+		if(nMaxBits > HuffmanCoding::Encoder::MaxCodeBits)
+		{
+			throw std::runtime_error("The maximum code length exceeds what the encoder can hold");
+		}
+
+		Serialization::ConvertHuffmanCode(argv[2], argv[3], nMaxBits);
+
+		std::cout << "[INFO] Written " << argv[3] << std::endl;
+		if(nMaxBits != 0)
+		{
+			std::cout << "[INFO] Codes were limited to " << nMaxBits << " bits, which cannot read messages written with the original code" << std::endl;
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc >= 2 && string(argv[1]) == "--convert" && (argc == 4 || argc == 5))
+	{
+		return ConvertCode(argc, argv);
+	}
+
+	if(argc < 2 || argc > 3 || string(argv[1]) == "--convert")
+	{
+		std::cerr << "Usage: " << argv[0] << " <corpus directory> [output directory]" << std::endl;
+		std::cerr << "       " << argv[0] << " --convert <huffcode.map> <huffcode.bin> [maximum code length]" << std::endl;
+		std::cerr << "Writes huffcode.bin, huffcode.map, rans.freq and context.freq to the output directory, by default the current one." << std::endl;
+		std::cerr << "With --convert, writes the code of an archived huffcode.map as a binary code table, unchanged unless limited in length." << std::endl;
+		std::cerr << "Messages written with a code can only be read with the same code, so review before replacing the configuration." << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		const string outputPath = (argc == 3 ? string(argv[2]) : string(".")) + "/";
+		if(!fs::is_directory(outputPath))
+		{
+			throw std::runtime_error("The output directory does not exist");
+		}
+
+		/* Count the corpus */
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		vector<string> paths = Training::ListCorpus(argv[1]);
+		if(paths.empty())
+		{
+			throw std::runtime_error("The corpus directory contains no files");
+		}
+
+		Training::CorpusCounts counts = Training::CountCorpus(paths, ThreadPool::Default());
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "[INFO] Counted " << counts.nBytes << " bytes in " << counts.nFiles << " files in "
+		          << std::fixed << std::setprecision(2) << seconds << " s using " << ThreadPool::Default().size() << " threads" << std::endl;
+
+
+		/* Build the code */
+		FreqMap frequencies = Training::CorpusFrequencies(counts);
+		CodeLengthMap lengths = HuffmanCoding::ComputeCodeLengths(frequencies, HuffmanCoding::Encoder::MaxCodeBits);
+		HuffCodeMap codes = HuffmanCoding::GenerateCanonicalCodes(lengths);
+
+		std::cout << std::setprecision(4);
+		std::cout << "[INFO] Alphabet: " << frequencies.size() << " characters including end-of-file" << std::endl;
+		std::cout << "[INFO] Entropy: " << Training::Entropy(frequencies) << " bits per character" << std::endl;
+		std::cout << "[INFO] Trained code: " << Training::BitsPerChar(frequencies, lengths) << " bits per character" << std::endl;
+
+
+		/* Compare with the current code */
+		try
+		{
+			Utilities::LoadHuffmanCode();
+			double current = Training::BitsPerChar(frequencies, HuffmanCoding::GetCodeLengths(Utilities::HuffCode));
+			double trained = Training::BitsPerChar(frequencies, lengths);
+
+			std::cout << "[INFO] Current code: " << current << " bits per character, retraining saves "
+			          << std::setprecision(2) << 100 * (current - trained) / current << "%" << std::endl;
+		}
+		catch(std::out_of_range& e)
+		{
+			std::cout << "[INFO] Current code: cannot encode every character of the corpus" << std::endl;
+		}
+		catch(std::exception& e)
+		{
+			std::cout << "[INFO] Current code: not available" << std::endl;
+		}
+
+
+		/* Write the tables */
+		Serialization::SerializeCodeTable(codes, outputPath + "huffcode.bin");
+		Serialization::SerializeHuffmanCode(codes, outputPath + "huffcode.map");
+		Serialization::SerializeFrequencies(frequencies, outputPath + "rans.freq");
+		Serialization::SerializeContextFrequencies(Training::CorpusContextFrequencies(counts), outputPath + "context.freq");
+
+		std::cout << "[INFO] Written huffcode.bin, huffcode.map, rans.freq and context.freq to " << outputPath << std::endl;
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
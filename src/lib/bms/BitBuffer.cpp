@@ -0,0 +1,546 @@
+/**
+ * BitBuffer.cpp
+ *
+ * Word-packed binary vector with a read cursor. Bits are stored
+ * MSB-first in 64-bit words, so that consuming leading bits only
+ * advances the cursor and appending shifts whole words at once.
+ * Non-owning views and spans give read and write access to a range
+ * of bits without copying them.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "BitBuffer.h"
+#include "BitKernels.h"
+
+#include <algorithm>
+#include <assert.h>
+
+/* Number of words converted per call of the byte kernels */
+static const size_t BlockWords = 32;
+
+
+/** Creates an empty view. */
+BitView::BitView() : pWords(NULL), nWords(0), nOffset(0), nBits(0)
+{
+}
+
+/**
+ * Creates a view of \p nBits bits starting at bit \p nOffset of a word array.
+ * Bits behind the end of the word array are read as zero's.
+ * @param pWords Word array holding the bits.
+ * @param nWords Number of words in the array.
+ * @param nOffset Position of the first bit.
+ * @param nBits Number of bits.
+ */
+BitView::BitView(const Word* pWords, size_t nWords, size_t nOffset, size_t nBits) :
+		pWords(pWords), nWords(nWords), nOffset(nOffset), nBits(nBits)
+{
+}
+
+/**
+ * Returns the bit at position \p pos.
+ * @param pos Position of the bit.
+ * @result Value of the bit.
+ */
+bool BitView::operator[](size_t pos) const
+{
+	return Peek(pos, 1);
+}
+
+/**
+ * Reads up to 64 bits starting at position \p pos.
+ * Bits behind the end of the view are read as zero's.
+ * @param pos Position of the first bit.
+ * @param nBits Number of bits to be read.
+ * @result The bits as an unsigned integer, first bit most significant.
+ */
+uint64_t BitView::Peek(size_t pos, unsigned int nBits) const
+{
+	assert(nBits <= WordBits);
+
+	if (nBits == 0 || pos >= this->nBits)
+		return 0;
+
+	size_t p = nOffset + pos;
+	size_t idx = p / WordBits;
+	unsigned int offset = p % WordBits;
+
+	if (idx >= nWords)
+		return 0;
+
+	Word value = pWords[idx] << offset;
+	if (offset != 0 && idx + 1 < nWords)
+		value |= pWords[idx + 1] >> (WordBits - offset);
+
+	value >>= (WordBits - nBits);
+
+	/* Clear the bits behind the end of the view */
+	if (pos + nBits > this->nBits)
+	{
+		unsigned int nTail = pos + nBits - this->nBits;
+		value = (value >> nTail) << nTail;
+	}
+
+	return value;
+}
+
+/**
+ * Creates a view of a range of this view.
+ * @param pos Position of the first bit.
+ * @param nBits Number of bits.
+ * @result View of the range.
+ */
+BitView BitView::Sub(size_t pos, size_t nBits) const
+{
+	assert(pos + nBits <= this->nBits);
+
+	return BitView(pWords, nWords, nOffset + pos, nBits);
+}
+
+/**
+ * Copies the bits into a byte array, each byte most significant bit first.
+ * An incomplete last byte is padded with zero's.
+ * @param pOut Output array with room for size()/8 rounded up bytes.
+ */
+void BitView::CopyBytes(unsigned char* pOut) const
+{
+	const size_t nBytes = (size() + 7) / 8;
+	Word block[BlockWords];
+
+	for (size_t i = 0; i < nBytes; i += 8 * BlockWords)
+	{
+		const size_t nBlockBytes = std::min(nBytes - i, (size_t)8 * BlockWords);
+		for (size_t j = 0; 8 * j < nBlockBytes; j++)
+			block[j] = Peek(8 * (i + 8 * j), WordBits);
+
+		BitKernels::UnpackWords(block, nBlockBytes, pOut + i);
+	}
+}
+
+/**
+ * Compares the bits of two views.
+ * @param other The other view.
+ * @result True if both hold the same bits. Otherwise not.
+ */
+bool BitView::operator==(const BitView& other) const
+{
+	const size_t Size = size();
+	if (Size != other.size())
+		return false;
+
+	for (size_t i = 0; i < Size; i += WordBits)
+	{
+		unsigned int n = std::min((size_t)WordBits, Size - i);
+		if (Peek(i, n) != other.Peek(i, n))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Compares the bits of two views lexicographically.
+ * @param other The other view.
+ * @result True if this view orders before the other. Otherwise not.
+ */
+bool BitView::operator<(const BitView& other) const
+{
+	const size_t Common = std::min(size(), other.size());
+
+	for (size_t i = 0; i < Common; i += WordBits)
+	{
+		unsigned int n = std::min((size_t)WordBits, Common - i);
+		uint64_t a = Peek(i, n);
+		uint64_t b = other.Peek(i, n);
+
+		if (a != b)
+			return a < b;
+	}
+
+	return size() < other.size();
+}
+
+
+/**
+ * Creates a writable span of \p nBits bits over a word array.
+ * @param pWords Word array with room for \p nBits bits.
+ * @param nBits Number of bits.
+ */
+BitSpan::BitSpan(Word* pWords, size_t nBits) : pWords(pWords), nBits(nBits)
+{
+}
+
+/**
+ * Overwrites \p nBits bits at position \p pos with the least significant
+ * bits of \p value, most significant first.
+ * @param pos Position of the first bit.
+ * @param value Bits to be written.
+ * @param nBits Number of bits to be written.
+ */
+void BitSpan::Write(size_t pos, uint64_t value, unsigned int nBits)
+{
+	assert(nBits <= WordBits);
+	assert(pos + nBits <= this->nBits);
+
+	if (nBits == 0)
+		return;
+
+	const Word Mask = ~(Word)0 << (WordBits - nBits);
+	Word aligned = value << (WordBits - nBits);
+
+	size_t idx = pos / WordBits;
+	unsigned int offset = pos % WordBits;
+
+	pWords[idx] = (pWords[idx] & ~(Mask >> offset)) | (aligned >> offset);
+	if (offset + nBits > WordBits)
+	{
+		unsigned int shift = WordBits - offset;
+		pWords[idx + 1] = (pWords[idx + 1] & ~(Mask << shift)) | (aligned << shift);
+	}
+}
+
+/**
+ * Overwrites the bits at position \p pos with the bits of a view.
+ * @param pos Position of the first bit.
+ * @param Bits Bits to be written.
+ */
+void BitSpan::Write(size_t pos, const BitView& Bits)
+{
+	const size_t Size = Bits.size();
+
+	for (size_t i = 0; i < Size; i += WordBits)
+	{
+		unsigned int n = std::min((size_t)WordBits, Size - i);
+		Write(pos + i, Bits.Peek(i, n), n);
+	}
+}
+
+/** Creates a read-only view of the span. */
+BitSpan::operator BitView() const
+{
+	return BitView(pWords, (nBits + WordBits - 1) / WordBits, 0, nBits);
+}
+
+
+/** Creates an empty binary vector. */
+BitBuffer::BitBuffer() : nBegin(0), nEnd(0)
+{
+}
+
+/**
+ * Creates a binary vector of \p nBits zero's.
+ * @param nBits Number of bits.
+ */
+BitBuffer::BitBuffer(size_t nBits) : words((nBits + WordBits - 1) / WordBits, 0), nBegin(0), nEnd(nBits)
+{
+}
+
+/**
+ * Creates a binary vector from a list of bits.
+ * @param Bits List of bits.
+ */
+BitBuffer::BitBuffer(std::initializer_list<bool> Bits) : nBegin(0), nEnd(0)
+{
+	reserve(Bits.size());
+	Append(Bits.begin(), Bits.end());
+}
+
+/**
+ * Creates a binary vector holding a copy of the bits of a view.
+ * @param Bits View of the bits.
+ */
+BitBuffer::BitBuffer(const BitView& Bits) : nBegin(0), nEnd(0)
+{
+	Append(Bits);
+}
+
+/** Removes all bits and resets the read cursor. */
+void BitBuffer::clear()
+{
+	words.clear();
+	nBegin = 0;
+	nEnd = 0;
+}
+
+/**
+ * Reserves storage for a total of \p nBits unconsumed bits.
+ * @param nBits Number of bits.
+ */
+void BitBuffer::reserve(size_t nBits)
+{
+	words.reserve((nBegin + nBits + WordBits - 1) / WordBits);
+}
+
+/**
+ * Truncates the binary vector or extends it with zero's to \p nBits bits.
+ * @param nBits New number of bits.
+ */
+void BitBuffer::resize(size_t nBits)
+{
+	if (nBits >= size())
+	{
+		Pad(nBits - size());
+		return;
+	}
+
+	nEnd = nBegin + nBits;
+	words.resize((nEnd + WordBits - 1) / WordBits);
+
+	/* Keep the bits behind the end cleared */
+	unsigned int offset = nEnd % WordBits;
+	if (offset != 0)
+		words.back() &= ~(Word)0 << (WordBits - offset);
+}
+
+/**
+ * Returns the bit at position \p pos relative to the read cursor.
+ * @param pos Position of the bit.
+ * @result Value of the bit.
+ */
+bool BitBuffer::operator[](size_t pos) const
+{
+	return View(pos, 1).Peek(0, 1);
+}
+
+/**
+ * Sets the bit at position \p pos relative to the read cursor.
+ * @param pos Position of the bit.
+ * @param bit New value of the bit.
+ */
+void BitBuffer::Set(size_t pos, bool bit)
+{
+	assert(pos < size());
+
+	size_t p = nBegin + pos;
+	Word mask = (Word)1 << (WordBits - 1 - p % WordBits);
+
+	if (bit)
+		words[p / WordBits] |= mask;
+	else
+		words[p / WordBits] &= ~mask;
+}
+
+/**
+ * Reads up to 64 bits starting at position \p pos without consuming them.
+ * Bits behind the end of the vector are read as zero's.
+ * @param pos Position of the first bit.
+ * @param nBits Number of bits to be read.
+ * @result The bits as an unsigned integer, first bit most significant.
+ */
+uint64_t BitBuffer::Peek(size_t pos, unsigned int nBits) const
+{
+	return View(pos, nBits).Peek(0, nBits);
+}
+
+/**
+ * Creates a view of \p nBits bits starting at position \p pos.
+ * The view may reach behind the end of the vector, those bits are read as zero's.
+ * It remains valid until the binary vector is modified.
+ * @param pos Position of the first bit.
+ * @param nBits Number of bits.
+ * @result View of the bits.
+ */
+BitView BitBuffer::View(size_t pos, size_t nBits) const
+{
+	return BitView(words.data(), words.size(), nBegin + pos, nBits);
+}
+
+/** Creates a view of all unconsumed bits. */
+BitBuffer::operator BitView() const
+{
+	return View(0, size());
+}
+
+/**
+ * Appends a single bit.
+ * @param bit Value of the bit.
+ */
+void BitBuffer::push_back(bool bit)
+{
+	Append((uint64_t)bit, 1);
+}
+
+/**
+ * Appends the \p nBits least significant bits of \p value, most significant first.
+ * @param value Bits to be appended.
+ * @param nBits Number of bits to be appended.
+ */
+void BitBuffer::Append(uint64_t value, unsigned int nBits)
+{
+	assert(nBits <= WordBits);
+
+	if (nBits == 0)
+		return;
+
+	Word aligned = value << (WordBits - nBits);
+	unsigned int offset = nEnd % WordBits;
+
+	if (offset == 0)
+	{
+		Compact();
+		words.push_back(aligned);
+	}
+	else
+	{
+		words.back() |= aligned >> offset;
+		if (offset + nBits > WordBits)
+		{
+			Compact();
+			words.push_back(aligned << (WordBits - offset));
+		}
+	}
+
+	nEnd += nBits;
+}
+
+/**
+ * Appends the bits of a view one word at a time.
+ * @param Bits View of the bits to be appended.
+ */
+void BitBuffer::Append(const BitView& Bits)
+{
+	/* Appending may reallocate the words the view refers to */
+	if (Bits.pWords != NULL && Bits.pWords == words.data())
+	{
+		BitBuffer tmp(Bits);
+		Append(tmp);
+		return;
+	}
+
+	const size_t Size = Bits.size();
+	reserve(size() + Size);
+
+	for (size_t i = 0; i < Size; i += WordBits)
+	{
+		unsigned int n = std::min((size_t)WordBits, Size - i);
+		Append(Bits.Peek(i, n), n);
+	}
+}
+
+/**
+ * Appends \p nBytes bytes, each most significant bit first.
+ * @param pData Bytes to be appended.
+ * @param nBytes Number of bytes.
+ */
+void BitBuffer::AppendBytes(const unsigned char* pData, size_t nBytes)
+{
+	reserve(size() + 8 * nBytes);
+	Word block[BlockWords];
+
+	for (size_t i = 0; i < nBytes; i += 8 * BlockWords)
+	{
+		const size_t nBlockBytes = std::min(nBytes - i, (size_t)8 * BlockWords);
+		BitKernels::PackBytes(pData + i, nBlockBytes, block);
+
+		for (size_t j = 0; 8 * j < nBlockBytes; j++)
+		{
+			const unsigned int nBits = std::min(nBlockBytes - 8 * j, (size_t)8) * 8;
+			Append(block[j] >> (WordBits - nBits), nBits);
+		}
+	}
+}
+
+/**
+ * Pads the binary vector with \p nBits zero's.
+ * @param nBits Number of padding bits.
+ */
+void BitBuffer::Pad(size_t nBits)
+{
+	Compact();
+
+	nEnd += nBits;
+	words.resize((nEnd + WordBits - 1) / WordBits, 0);
+}
+
+/**
+ * Reads and consumes up to 64 leading bits.
+ * @param nBits Number of bits to be read.
+ * @result The bits as an unsigned integer, first bit most significant.
+ */
+uint64_t BitBuffer::Read(unsigned int nBits)
+{
+	uint64_t value = Peek(0, nBits);
+	Skip(nBits);
+
+	return value;
+}
+
+/**
+ * Cuts the first \p nBits bits out of the binary vector and returns them.
+ * Only the returned bits are copied, the remainder is left in place.
+ * @param nBits Number of leading bits to be cut out.
+ * @result The leading bits.
+ */
+BitBuffer BitBuffer::Slice(size_t nBits)
+{
+	assert(nBits <= size());
+
+	BitBuffer slice;
+	slice.reserve(nBits);
+
+	for (size_t i = 0; i < nBits; i += WordBits)
+	{
+		unsigned int n = std::min((size_t)WordBits, nBits - i);
+		slice.Append(Peek(i, n), n);
+	}
+
+	Skip(nBits);
+
+	return slice;
+}
+
+/**
+ * Consumes the first \p nBits bits by advancing the read cursor.
+ * @param nBits Number of leading bits to be skipped.
+ */
+void BitBuffer::Skip(size_t nBits)
+{
+	nBegin += std::min(nBits, size());
+
+	if (nBegin == nEnd)
+		clear();
+}
+
+/**
+ * Copies the bits into a byte array, each byte most significant bit first.
+ * An incomplete last byte is padded with zero's.
+ * @param pOut Output array with room for size()/8 rounded up bytes.
+ */
+void BitBuffer::CopyBytes(unsigned char* pOut) const
+{
+	BitView(*this).CopyBytes(pOut);
+}
+
+/**
+ * Compares the unconsumed bits of two binary vectors.
+ * @param other The other binary vector.
+ * @result True if both hold the same bits. Otherwise not.
+ */
+bool BitBuffer::operator==(const BitBuffer& other) const
+{
+	return BitView(*this) == BitView(other);
+}
+
+/**
+ * Compares the unconsumed bits of two binary vectors lexicographically.
+ * @param other The other binary vector.
+ * @result True if this binary vector orders before the other. Otherwise not.
+ */
+bool BitBuffer::operator<(const BitBuffer& other) const
+{
+	return BitView(*this) < BitView(other);
+}
+
+/** Releases consumed words once they make up at least half of the storage. */
+void BitBuffer::Compact()
+{
+	size_t nWords = nBegin / WordBits;
+	if (nWords == 0 || 2 * nWords < words.size())
+		return;
+
+	words.erase(words.begin(), words.begin() + nWords);
+	nBegin -= nWords * WordBits;
+	nEnd -= nWords * WordBits;
+}
@@ -0,0 +1,189 @@
+/**
+ * BitBuffer.h
+ *
+ * Word-packed binary vector with a read cursor. Bits are stored
+ * MSB-first in 64-bit words, so that consuming leading bits only
+ * advances the cursor and appending shifts whole words at once.
+ * Non-owning views and spans give read and write access to a range
+ * of bits without copying them.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_BITBUFFER_H
+#define BMS_BITBUFFER_H
+
+#include <cstddef>
+#include <iterator>
+#include <stdint.h>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+
+class BitView
+{
+public:
+	typedef uint64_t Word;
+	static const unsigned int WordBits = 64;
+
+	/* === Constructors === */
+	BitView();
+	BitView(const Word* pWords, size_t nWords, size_t nOffset, size_t nBits);
+
+	/* === Capacity === */
+	size_t size() const { return nBits; }
+	bool empty() const { return nBits == 0; }
+
+	/* === Element access === */
+	bool operator[](size_t pos) const;
+	uint64_t Peek(size_t pos, unsigned int nBits) const;
+	BitView Sub(size_t pos, size_t nBits) const;
+
+	void CopyBytes(unsigned char* pOut) const;
+
+	/* === Comparison === */
+	bool operator==(const BitView& other) const;
+	bool operator!=(const BitView& other) const { return !(*this == other); }
+	bool operator<(const BitView& other) const;
+
+private:
+	friend class BitBuffer;
+
+	const Word* pWords;
+	size_t nWords;
+	size_t nOffset;
+	size_t nBits;
+};
+
+class BitSpan
+{
+public:
+	typedef BitView::Word Word;
+	static const unsigned int WordBits = BitView::WordBits;
+
+	/* === Constructors === */
+	BitSpan(Word* pWords, size_t nBits);
+
+	/* === Capacity === */
+	size_t size() const { return nBits; }
+
+	/* === Element access === */
+	void Write(size_t pos, uint64_t value, unsigned int nBits);
+	void Write(size_t pos, const BitView& Bits);
+
+	operator BitView() const;
+
+private:
+	Word* pWords;
+	size_t nBits;
+};
+
+class BitBuffer
+{
+public:
+	typedef BitView::Word Word;
+	static const unsigned int WordBits = BitView::WordBits;
+
+	class const_iterator
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef bool value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const bool* pointer;
+		typedef bool reference;
+
+		const_iterator() : buf(NULL), pos(0) { }
+		const_iterator(const BitBuffer* Buf, size_t Pos) : buf(Buf), pos(Pos) { }
+
+		bool operator*() const { return (*buf)[pos]; }
+		bool operator[](difference_type n) const { return (*buf)[pos + n]; }
+
+		const_iterator& operator++() { pos++; return *this; }
+		const_iterator operator++(int) { const_iterator tmp = *this; pos++; return tmp; }
+		const_iterator& operator--() { pos--; return *this; }
+		const_iterator operator--(int) { const_iterator tmp = *this; pos--; return tmp; }
+		const_iterator& operator+=(difference_type n) { pos += n; return *this; }
+		const_iterator& operator-=(difference_type n) { pos -= n; return *this; }
+		const_iterator operator+(difference_type n) const { return const_iterator(buf, pos + n); }
+		const_iterator operator-(difference_type n) const { return const_iterator(buf, pos - n); }
+		difference_type operator-(const const_iterator& other) const { return (difference_type)pos - (difference_type)other.pos; }
+
+		bool operator==(const const_iterator& other) const { return pos == other.pos; }
+		bool operator!=(const const_iterator& other) const { return pos != other.pos; }
+		bool operator<(const const_iterator& other) const { return pos < other.pos; }
+		bool operator>(const const_iterator& other) const { return pos > other.pos; }
+		bool operator<=(const const_iterator& other) const { return pos <= other.pos; }
+		bool operator>=(const const_iterator& other) const { return pos >= other.pos; }
+
+	private:
+		const BitBuffer* buf;
+		size_t pos;
+	};
+
+	/* === Constructors === */
+	BitBuffer();
+	explicit BitBuffer(size_t nBits);
+	BitBuffer(std::initializer_list<bool> Bits);
+	explicit BitBuffer(const BitView& Bits);
+
+	template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	BitBuffer(InputIt first, InputIt last) : nBegin(0), nEnd(0)
+	{
+		Append(first, last);
+	}
+
+	/* === Capacity === */
+	size_t size() const { return nEnd - nBegin; }
+	bool empty() const { return nEnd == nBegin; }
+	void clear();
+	void reserve(size_t nBits);
+	void resize(size_t nBits);
+
+	/* === Element access === */
+	bool operator[](size_t pos) const;
+	void Set(size_t pos, bool bit);
+	uint64_t Peek(size_t pos, unsigned int nBits) const;
+	BitView View(size_t pos, size_t nBits) const;
+
+	operator BitView() const;
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	/* === Appending === */
+	void push_back(bool bit);
+	void Append(uint64_t value, unsigned int nBits);
+	void Append(const BitView& Bits);
+	void AppendBytes(const unsigned char* pData, size_t nBytes);
+	void Pad(size_t nBits);
+
+	template<typename InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+	void Append(InputIt first, InputIt last)
+	{
+		for (; first != last; ++first)
+			push_back((bool)*first);
+	}
+
+	/* === Consuming === */
+	uint64_t Read(unsigned int nBits);
+	BitBuffer Slice(size_t nBits);
+	void Skip(size_t nBits);
+
+	void CopyBytes(unsigned char* pOut) const;
+
+	/* === Comparison === */
+	bool operator==(const BitBuffer& other) const;
+	bool operator!=(const BitBuffer& other) const { return !(*this == other); }
+	bool operator<(const BitBuffer& other) const;
+
+private:
+	std::vector<Word> words;
+	size_t nBegin;
+	size_t nEnd;
+
+	void Compact();
+};
+
+#endif
@@ -0,0 +1,430 @@
+/**
+ * BitKernels.cpp
+ *
+ * Conversion kernels between bytes, MSB-first packed words and
+ * one-byte-per-bit arrays. Vectorized SSE2, AVX2 and BMI2 variants
+ * are selected at runtime depending on the capabilities of the CPU.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "BitKernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BMS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace BitKernels
+{
+
+typedef void (*PackFn)(const unsigned char* pIn, size_t nWords, uint64_t* pOut);
+typedef void (*UnpackFn)(const uint64_t* pIn, size_t nWords, unsigned char* pOut);
+typedef void (*ExpandFn)(const unsigned char* pIn, size_t nBytes, unsigned char* pOut);
+typedef void (*CompactFn)(const unsigned char* pIn, size_t nBytes, unsigned char* pOut);
+
+struct KernelTable
+{
+	Implementation impl;
+	PackFn pack;
+	UnpackFn unpack;
+	ExpandFn expand;
+	CompactFn compact;
+};
+
+
+/* === Scalar kernels === */
+
+static void PackScalar(const unsigned char* pIn, size_t nWords, uint64_t* pOut)
+{
+	for (size_t i = 0; i < nWords; i++)
+	{
+		uint64_t w = 0;
+		for (unsigned int j = 0; j < 8; j++)
+			w = (w << 8) | pIn[8 * i + j];
+
+		pOut[i] = w;
+	}
+}
+
+static void UnpackScalar(const uint64_t* pIn, size_t nWords, unsigned char* pOut)
+{
+	for (size_t i = 0; i < nWords; i++)
+	{
+		uint64_t w = pIn[i];
+		for (int j = 7; j >= 0; j--)
+		{
+			pOut[8 * i + j] = w & 0xFF;
+			w >>= 8;
+		}
+	}
+}
+
+static void ExpandScalar(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		for (unsigned int j = 0; j < 8; j++)
+			pOut[8 * i + j] = (pIn[i] >> (7 - j)) & 0x01;
+	}
+}
+
+static void CompactScalar(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		unsigned char c = 0x00;
+		for (unsigned int j = 0; j < 8; j++)
+			c = (c << 1) | (pIn[8 * i + j] != 0);
+
+		pOut[i] = c;
+	}
+}
+
+
+#ifdef BMS_X86_KERNELS
+
+/* === SSE2 kernels === */
+
+/** Reverses the byte order within both 64-bit lanes. */
+__attribute__((target("sse2")))
+static inline __m128i ReverseLanesSSE2(__m128i x)
+{
+	x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+__attribute__((target("sse2")))
+static void PackSSE2(const unsigned char* pIn, size_t nWords, uint64_t* pOut)
+{
+	size_t i = 0;
+	for (; i + 2 <= nWords; i += 2)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(pIn + 8 * i));
+		_mm_storeu_si128((__m128i*)(pOut + i), ReverseLanesSSE2(x));
+	}
+
+	PackScalar(pIn + 8 * i, nWords - i, pOut + i);
+}
+
+__attribute__((target("sse2")))
+static void UnpackSSE2(const uint64_t* pIn, size_t nWords, unsigned char* pOut)
+{
+	size_t i = 0;
+	for (; i + 2 <= nWords; i += 2)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(pIn + i));
+		_mm_storeu_si128((__m128i*)(pOut + 8 * i), ReverseLanesSSE2(x));
+	}
+
+	UnpackScalar(pIn + i, nWords - i, pOut + 8 * i);
+}
+
+__attribute__((target("sse2")))
+static void ExpandSSE2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const __m128i Mask = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i One = _mm_set1_epi8(1);
+
+	size_t i = 0;
+	for (; i + 2 <= nBytes; i += 2)
+	{
+		/* Broadcast each byte into eight lanes */
+		__m128i x = _mm_cvtsi32_si128(pIn[i] | (pIn[i + 1] << 8));
+		x = _mm_unpacklo_epi8(x, x);
+		x = _mm_unpacklo_epi16(x, x);
+		x = _mm_unpacklo_epi32(x, x);
+
+		x = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(x, Mask), Mask), One);
+		_mm_storeu_si128((__m128i*)(pOut + 8 * i), x);
+	}
+
+	ExpandScalar(pIn + i, nBytes - i, pOut + 8 * i);
+}
+
+__attribute__((target("sse2")))
+static void CompactSSE2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const __m128i Zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 2 <= nBytes; i += 2)
+	{
+		__m128i x = ReverseLanesSSE2(_mm_loadu_si128((const __m128i*)(pIn + 8 * i)));
+		unsigned int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, Zero));
+
+		pOut[i] = mask & 0xFF;
+		pOut[i + 1] = (mask >> 8) & 0xFF;
+	}
+
+	CompactScalar(pIn + 8 * i, nBytes - i, pOut + i);
+}
+
+
+/* === AVX2 kernels === */
+
+/** Reverses the byte order within all four 64-bit lanes. */
+__attribute__((target("avx2")))
+static inline __m256i ReverseLanesAVX2(__m256i x)
+{
+	const __m256i Shuffle = _mm256_setr_epi8(
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+			7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+	return _mm256_shuffle_epi8(x, Shuffle);
+}
+
+__attribute__((target("avx2")))
+static void PackAVX2(const unsigned char* pIn, size_t nWords, uint64_t* pOut)
+{
+	size_t i = 0;
+	for (; i + 4 <= nWords; i += 4)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(pIn + 8 * i));
+		_mm256_storeu_si256((__m256i*)(pOut + i), ReverseLanesAVX2(x));
+	}
+
+	PackScalar(pIn + 8 * i, nWords - i, pOut + i);
+}
+
+__attribute__((target("avx2")))
+static void UnpackAVX2(const uint64_t* pIn, size_t nWords, unsigned char* pOut)
+{
+	size_t i = 0;
+	for (; i + 4 <= nWords; i += 4)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(pIn + i));
+		_mm256_storeu_si256((__m256i*)(pOut + 8 * i), ReverseLanesAVX2(x));
+	}
+
+	UnpackScalar(pIn + i, nWords - i, pOut + 8 * i);
+}
+
+__attribute__((target("avx2")))
+static void ExpandAVX2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const __m256i Broadcast = _mm256_setr_epi8(
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+			2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i Mask = _mm256_setr_epi8(
+			-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+			-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m256i One = _mm256_set1_epi8(1);
+
+	size_t i = 0;
+	for (; i + 4 <= nBytes; i += 4)
+	{
+		int32_t v;
+		memcpy(&v, pIn + i, 4);
+
+		/* Broadcast each byte into eight lanes */
+		__m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32(v), Broadcast);
+
+		x = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(x, Mask), Mask), One);
+		_mm256_storeu_si256((__m256i*)(pOut + 8 * i), x);
+	}
+
+	ExpandScalar(pIn + i, nBytes - i, pOut + 8 * i);
+}
+
+__attribute__((target("avx2")))
+static void CompactAVX2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const __m256i Zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 4 <= nBytes; i += 4)
+	{
+		__m256i x = ReverseLanesAVX2(_mm256_loadu_si256((const __m256i*)(pIn + 8 * i)));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, Zero));
+
+		for (unsigned int j = 0; j < 4; j++)
+			pOut[i + j] = (mask >> (8 * j)) & 0xFF;
+	}
+
+	CompactScalar(pIn + 8 * i, nBytes - i, pOut + i);
+}
+
+
+/* === BMI2 kernels === */
+
+__attribute__((target("bmi2")))
+static void ExpandBMI2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		/* Deposit bit j into byte j, then put the most significant bit first */
+		uint64_t v = __builtin_bswap64(_pdep_u64(pIn[i], 0x0101010101010101ULL));
+		memcpy(pOut + 8 * i, &v, 8);
+	}
+}
+
+__attribute__((target("bmi2")))
+static void CompactBMI2(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const uint64_t Low7 = 0x7F7F7F7F7F7F7F7FULL;
+
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		uint64_t v;
+		memcpy(&v, pIn + 8 * i, 8);
+
+		/* Normalize every non-zero byte to one */
+		v = ((((v & Low7) + Low7) | v) >> 7) & 0x0101010101010101ULL;
+
+		pOut[i] = _pext_u64(__builtin_bswap64(v), 0x0101010101010101ULL);
+	}
+}
+
+#endif
+
+
+/**
+ * Checks whether the CPU supports a kernel implementation.
+ * @param impl The kernel implementation.
+ * @result True if the implementation can be used. Otherwise not.
+ */
+bool IsSupported(Implementation impl)
+{
+#ifdef BMS_X86_KERNELS
+	__builtin_cpu_init();
+
+	switch (impl)
+	{
+	case SSE2:
+		return __builtin_cpu_supports("sse2");
+	case AVX2:
+		return __builtin_cpu_supports("avx2");
+	case BMI2:
+		return __builtin_cpu_supports("bmi2");
+	default:
+		return true;
+	}
+#else
+	return impl == SCALAR;
+#endif
+}
+
+static KernelTable MakeTable(Implementation impl)
+{
+	KernelTable table = {SCALAR, &PackScalar, &UnpackScalar, &ExpandScalar, &CompactScalar};
+
+#ifdef BMS_X86_KERNELS
+	switch (impl)
+	{
+	case SSE2:
+		table = {SSE2, &PackSSE2, &UnpackSSE2, &ExpandSSE2, &CompactSSE2};
+		break;
+	case AVX2:
+		table = {AVX2, &PackAVX2, &UnpackAVX2, &ExpandAVX2, &CompactAVX2};
+		break;
+	case BMI2:
+		table = {BMI2, &PackScalar, &UnpackScalar, &ExpandBMI2, &CompactBMI2};
+		break;
+	default:
+		break;
+	}
+#endif
+
+	return table;
+}
+
+static KernelTable DetectTable()
+{
+	const Implementation Preference[] = {AVX2, BMI2, SSE2};
+
+	for (unsigned int i = 0; i < sizeof(Preference) / sizeof(Preference[0]); i++)
+	{
+		if (IsSupported(Preference[i]))
+			return MakeTable(Preference[i]);
+	}
+
+	return MakeTable(SCALAR);
+}
+
+static KernelTable Kernels = DetectTable();
+
+/**
+ * Returns the kernel implementation currently in use.
+ * @result The kernel implementation.
+ */
+Implementation GetImplementation()
+{
+	return Kernels.impl;
+}
+
+/**
+ * Overrides the kernel implementation selected at startup.
+ * @param impl A kernel implementation supported by the CPU.
+ */
+void SetImplementation(Implementation impl)
+{
+	if (IsSupported(impl))
+		Kernels = MakeTable(impl);
+}
+
+/**
+ * Packs bytes into words, each word holding eight bytes most significant first.
+ * An incomplete last word is padded with zero's.
+ * @param pIn Bytes to be packed.
+ * @param nBytes Number of bytes.
+ * @param pOut Output array with room for nBytes/8 rounded up words.
+ */
+void PackBytes(const unsigned char* pIn, size_t nBytes, uint64_t* pOut)
+{
+	const size_t nWords = nBytes / 8;
+	Kernels.pack(pIn, nWords, pOut);
+
+	if (nBytes % 8 != 0)
+	{
+		uint64_t w = 0;
+		for (size_t i = 8 * nWords; i < nBytes; i++)
+			w |= (uint64_t)pIn[i] << (56 - 8 * (i % 8));
+
+		pOut[nWords] = w;
+	}
+}
+
+/**
+ * Unpacks words into bytes, each word holding eight bytes most significant first.
+ * @param pIn Words to be unpacked.
+ * @param nBytes Number of bytes.
+ * @param pOut Output array with room for \p nBytes bytes.
+ */
+void UnpackWords(const uint64_t* pIn, size_t nBytes, unsigned char* pOut)
+{
+	const size_t nWords = nBytes / 8;
+	Kernels.unpack(pIn, nWords, pOut);
+
+	for (size_t i = 8 * nWords; i < nBytes; i++)
+		pOut[i] = (pIn[nWords] >> (56 - 8 * (i % 8))) & 0xFF;
+}
+
+/**
+ * Expands every bit into a byte of value zero or one, most significant bit first.
+ * @param pIn Bytes to be expanded.
+ * @param nBytes Number of bytes.
+ * @param pOut Output array with room for 8 * \p nBytes bytes.
+ */
+void ExpandBits(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	Kernels.expand(pIn, nBytes, pOut);
+}
+
+/**
+ * Compacts every eight bytes into the bits of a single byte, most significant bit first.
+ * Any non-zero byte is treated as a set bit.
+ * @param pIn Bytes to be compacted.
+ * @param nBytes Number of output bytes.
+ * @param pOut Output array with room for \p nBytes bytes.
+ */
+void CompactBits(const unsigned char* pIn, size_t nBytes, unsigned char* pOut)
+{
+	Kernels.compact(pIn, nBytes, pOut);
+}
+
+}
@@ -0,0 +1,39 @@
+/**
+ * BitKernels.h
+ *
+ * Conversion kernels between bytes, MSB-first packed words and
+ * one-byte-per-bit arrays. Vectorized SSE2, AVX2 and BMI2 variants
+ * are selected at runtime depending on the capabilities of the CPU.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_BITKERNELS_H
+#define BMS_BITKERNELS_H
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace BitKernels
+{
+	enum Implementation
+	{
+		SCALAR,
+		SSE2,
+		AVX2,
+		BMI2
+	};
+
+	bool IsSupported(Implementation impl);
+	Implementation GetImplementation();
+	void SetImplementation(Implementation impl);
+
+	void PackBytes(const unsigned char* pIn, size_t nBytes, uint64_t* pOut);
+	void UnpackWords(const uint64_t* pIn, size_t nBytes, unsigned char* pOut);
+
+	void ExpandBits(const unsigned char* pIn, size_t nBytes, unsigned char* pOut);
+	void CompactBits(const unsigned char* pIn, size_t nBytes, unsigned char* pOut);
+};
+
+#endif
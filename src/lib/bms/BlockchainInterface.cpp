@@ -95,20 +95,18 @@ CBitcoinAddress SelectAddress()
  */
 void PackDataIntoSeqNr(DataBits& bits, CTxIn& txIn)
 {
-	int nBits = std::min(32, (int)bits.size());
-	PadBits(bits, 32 - nBits);
-	DataBits slice = SliceBits(bits, 32);
-
-	txIn.nSequence = DataInterface::EncodeDataInSequenceNr(slice);
+	txIn.nSequence = DataInterface::EncodeDataInSequenceNr(bits.View(0, 32));
+	bits.Skip(32);
 }
 
 /**
  * Extracts data from the sequence number of a transaction input.
- * @result Embedded data.
+ * @param txIn A transaction input.
+ * @param bits Binary vector to which the embedded data is appended.
  */
-DataBits UnpackDataFromSeqNr(const CTxIn& txIn)
+void UnpackDataFromSeqNr(const CTxIn& txIn, DataBits& bits)
 {
-	return DataInterface::DecodeDataInSequenceNr(txIn.nSequence);
+	DataInterface::DecodeDataInSequenceNr(txIn.nSequence, bits);
 }
 
 /**
@@ -123,30 +121,54 @@ DataBits UnpackDataFromSeqNr(const CTxIn& txIn)
  */
 void PackDataIntoP2SH(DataBits& bits, CTxOut& txOut, CTransaction& tx, int nInput)
 {
-	DataBits slice;
-	vector<CPubKey> pubkeys;
-	CScript multisigAddress;
+	P2SHSlices slices = SliceDataForP2SH(bits);
+	vector<CPubKey> pubkeys = DataInterface::EncodeDataInPubkeys(slices.keys, 5);
 
-	/* Embed data into first public key */
-	int nSuffixBits = std::stoi(Utilities::Config.at("Keymap.SuffixBits"));
-	int nBits = std::min(nSuffixBits, (int)bits.size());
+	PackPubkeysIntoP2SH(slices.suffix, pubkeys, txOut, tx, nInput);
+}
 
-	PadBits(bits, nSuffixBits - nBits);
-	slice = SliceBits(bits, nSuffixBits);
+/**
+ * Slices the data of a P2SH script pair off the binary vector, i.e. the
+ * suffix selecting a keypair and the data of up to 11 further public keys.
+ * @param bits To be embedded data.
+ * @return The sliced data.
+ */
+P2SHSlices SliceDataForP2SH(DataBits& bits)
+{
+	P2SHSlices slices;
 
-	pubkeys.push_back(Utilities::KeyMap.at(slice).GetPubKey());
+	int nSuffixBits = std::stoi(Utilities::Config.at("Keymap.SuffixBits"));
+	slices.suffix = DataBits(bits.View(0, nSuffixBits));
+	bits.Skip(nSuffixBits);
 
-	/* Embed data into remaining pubkeys */
 	int nExtraKeys = std::min(11, (int)ceil(bits.size()/250.0));
 	for(int i = 0; i < nExtraKeys; i++)
 	{
-		nBits = std::min(250, (int)bits.size());
-		PadBits(bits, 250 - nBits);
-		slice = SliceBits(bits, 250);
-
-		pubkeys.push_back(DataInterface::EncodeDataInPubkey(slice,5));
+		slices.keys.push_back(DataBits(bits.View(0, 250)));
+		bits.Skip(250);
 	}
 
+	return slices;
+}
+
+/**
+ * Creates a script pair of P2SH standard transaction type from public keys
+ * that already embed the data. The redemption script is added to the keystore
+ * and the corresponding input is signed temporarily.
+ * @param suffix Suffix selecting the keypair of the first public key.
+ * @param dataPubkeys Public keys embedding data.
+ * @param txOut Transaction output of the current transaction.
+ * @param tx Current transaction.
+ * @param nInput Index of the current transaction input.
+ */
+void PackPubkeysIntoP2SH(const DataBits& suffix, const vector<CPubKey>& dataPubkeys, CTxOut& txOut, CTransaction& tx, int nInput)
+{
+	vector<CPubKey> pubkeys;
+	CScript multisigAddress;
+
+	pubkeys.push_back(Utilities::KeyMap.at(suffix).GetPubKey());
+	pubkeys.insert(pubkeys.end(), dataPubkeys.begin(), dataPubkeys.end());
+
 	multisigAddress.SetMultisig(1, pubkeys);
 	Utilities::Store.AddCScript(multisigAddress);
 
@@ -162,13 +184,10 @@ void PackDataIntoP2SH(DataBits& bits, CTxOut& txOut, CTransaction& tx, int nInpu
 /**
  * Extracts data from a signature script of P2SH transaction type.
  * @param txIn A transaction input.
- * @result Data embedded in the signature script.
+ * @param bits Binary vector to which the data embedded in the signature script is appended.
  */
-DataBits UnpackDataFromP2SH(const CTxIn& txIn)
+void UnpackDataFromP2SH(const CTxIn& txIn, DataBits& bits)
 {
-    DataBits bits;
-	DataBits slice;
-
 	vector<CPubKey> pubkeys;
 
 	CScript scriptSig = txIn.scriptSig;
@@ -198,19 +217,18 @@ DataBits UnpackDataFromP2SH(const CTxIn& txIn)
 
     /* Extract the data from the public keys */
     int nSuffixBits = std::stoi(Utilities::Config.at("Keymap.SuffixBits"));
-    DataBits buf = DataToBits(Data(pubkeys[0].begin(), pubkeys[0].end()));
-    slice = DataBits(buf.end()-nSuffixBits, buf.end());
-
-    pubkeys.erase(pubkeys.begin(),pubkeys.begin()+1);
-    bits.insert(bits.end(), slice.begin(), slice.end());
+    uint64_t suffix = 0;
 
-    for(vector<CPubKey>::const_iterator it = pubkeys.begin(); it != pubkeys.end(); it++)
+    for(unsigned int i = pubkeys[0].size() - 8; i < pubkeys[0].size(); i++)
     {
-    	slice = DataInterface::DecodeDataInPubkey(*it, 5);
-    	bits.insert(bits.end(), slice.begin(), slice.end());
+    	suffix = (suffix << 8) | pubkeys[0][i];
     }
+    bits.Append(suffix, nSuffixBits);
 
-    return bits;
+    for(vector<CPubKey>::const_iterator it = pubkeys.begin()+1; it != pubkeys.end(); it++)
+    {
+    	DataInterface::DecodeDataInPubkey(*it, 5, bits);
+    }
 }
 
 /**
@@ -220,25 +238,22 @@ DataBits UnpackDataFromP2SH(const CTxIn& txIn)
  */
 void PackDataIntoNulldata(DataBits& bits, CTxOut& txOut)
 {
-	int nBits = std::min(320, (int)bits.size());
-	PadBits(bits, 320 - nBits);
-	DataBits slice = SliceBits(bits, 320);
-
-	txOut.scriptPubKey = (CScript() << OP_RETURN << BitsToData(slice));
+	txOut.scriptPubKey = (CScript() << OP_RETURN << BitsToData(bits.View(0, 320)));
 	txOut.nValue = 0;
+
+	bits.Skip(320);
 }
 
 /**
  * Extracts data from a public key script of Nulldata transaction type.
  * @param txOut A transaction output of Nulldata type.
- * @result Data embedded in the public key script.
+ * @param bits Binary vector to which the data embedded in the public key script is appended.
  */
-DataBits UnpackDataFromNulldata(const CTxOut& txOut)
+void UnpackDataFromNulldata(const CTxOut& txOut, DataBits& bits)
 {
-	Data data = txOut.scriptPubKey;
-	data.erase(data.begin(), data.begin()+2);
+	const CScript& script = txOut.scriptPubKey;
 
-	return DataToBits(data);
+	bits.AppendBytes(&script[2], script.size() - 2);
 }
 
 /**
@@ -252,27 +267,25 @@ void PackDataIntoBudgetSplit(DataBits& bits, vector<CTxOut>& txOuts, uint64_t bu
 {
 	const uint32_t nOutputs = txOuts.size();
 	const uint32_t MaxBits = DataInterface::EmbeddableBitsInValues(budget - (nOutputs*lbound), nOutputs);
-	const uint32_t nBits = std::min(MaxBits, (uint32_t)bits.size());
 
 	assert(budget >= nOutputs * lbound);
 
-	DataBits slice = SliceBits(bits, nBits);
-	PadBits(slice, MaxBits - nBits);
-
-	vector<uint64_t> values = DataInterface::EncodeDataInValues(slice, budget - (nOutputs * lbound), nOutputs);
+	vector<uint64_t> values = DataInterface::EncodeDataInValues(bits.View(0, MaxBits), budget - (nOutputs * lbound), nOutputs);
 	for(unsigned int i = 0; i < nOutputs; i++)
 	{
 		txOuts[i].nValue = values[i] + lbound;
 	}
+
+	bits.Skip(MaxBits);
 }
 
 /**
  * Extracts data from transaction output values of a set of transaction outputs.
  * @param txOuts Vector of transaction outputs.
  * @param lbound Lower bound of each transaction output value.
- * @result Data embedded in transaction output values.
+ * @param bits Binary vector to which the data embedded in transaction output values is appended.
  */
-DataBits UnpackDataFromBudgetSplit(const vector<CTxOut>& txOuts, uint64_t lbound)
+void UnpackDataFromBudgetSplit(const vector<CTxOut>& txOuts, uint64_t lbound, DataBits& bits)
 {
 	const uint32_t outputs = txOuts.size();
 	vector<uint64_t> values(outputs);
@@ -282,7 +295,7 @@ DataBits UnpackDataFromBudgetSplit(const vector<CTxOut>& txOuts, uint64_t lbound
 		values[i] = txOuts[i].nValue - lbound;
 	}
 
-	return DataInterface::DecodeDataInValues(values);
+	DataInterface::DecodeDataInValues(values, bits);
 }
 
 /**
@@ -294,24 +307,22 @@ void PackDataIntoBudgetClaim(DataBits& bits, vector<CTxIn>& txInputs)
 {
 	const uint32_t nInputs = txInputs.size();
 	const uint32_t MaxBits = DataInterface::EmbeddableBitsInPermutation(nInputs);
-	const uint32_t nBits = std::min(MaxBits, (uint32_t)bits.size());
-
-	DataBits slice = SliceBits(bits, nBits);
-	PadBits(slice, MaxBits - nBits);
 
-	vector<uint16_t> perm = DataInterface::EncodeDataInPermutation(slice, nInputs);
+	vector<uint16_t> perm = DataInterface::EncodeDataInPermutation(bits.View(0, MaxBits), nInputs);
 	for(unsigned int i = 0; i < nInputs; i++)
 	{
 		txInputs[i].prevout.n = perm[i];
 	}
+
+	bits.Skip(MaxBits);
 }
 
 /**
  * Extracts data from the order of claimed transaction outputs.
  * @param txInputs Vector of transaction inputs.
- * @result Data embedded in the order of claimed transaction outputs.
+ * @param bits Binary vector to which the data embedded in the order of claimed transaction outputs is appended.
  */
-DataBits UnpackDataFromBudgetClaim(const vector<CTxIn>& txInputs)
+void UnpackDataFromBudgetClaim(const vector<CTxIn>& txInputs, DataBits& bits)
 {
 	const uint32_t nInputs = txInputs.size();
 	vector<uint16_t> perm(nInputs);
@@ -321,7 +332,7 @@ DataBits UnpackDataFromBudgetClaim(const vector<CTxIn>& txInputs)
 		perm[i] = txInputs[i].prevout.n;
 	}
 
-	return DataInterface::DecodeDataInPermutation(perm);
+	DataInterface::DecodeDataInPermutation(perm, bits);
 }
 
 /*
@@ -396,11 +407,20 @@ void OptimizeParams(const CTransaction& tx, const DataBits& bits, const uint64_t
 		if(nScriptHash >= 2)
 		{
 			if(nBudget >= nFees)
-				nBitsBudgetSplit = DataInterface::EmbeddableBitsInValues(nBudget-nFees, nScriptHash);
+				nBitsBudgetSplit = DataInterface::EmbeddableBitsInValuesBound(nBudget-nFees, nScriptHash);
 			else
 				nBitsBudgetSplit = 0;
 
-			nBitsBudgetClaim = DataInterface::EmbeddableBitsInPermutation(nScriptHash);
+			nBitsBudgetClaim = DataInterface::EmbeddableBitsInPermutationBound(nScriptHash);
+
+			/* Only compute the exact capacity if the estimate reaches the data size */
+			if(nTotalEmbeddableBits + nBitsBudgetSplit + nBitsBudgetClaim >= bits.size())
+			{
+				if(nBudget >= nFees)
+					nBitsBudgetSplit = DataInterface::EmbeddableBitsInValues(nBudget-nFees, nScriptHash);
+
+				nBitsBudgetClaim = DataInterface::EmbeddableBitsInPermutation(nScriptHash);
+			}
 
 			nTotalEmbeddableBits += nBitsBudgetSplit + nBitsBudgetClaim;
 		}
@@ -427,7 +447,6 @@ TransactionChain EmbedData(const DataBits& data, uint64_t nBudget, const vector<
 {
 	TransactionChain txs(2);
 	DataBits bits = data;
-	DataBits slice;
 	Parameters params;
 
 	for(vector<COutPoint>::const_iterator it = prevOut.begin(); it != prevOut.end(); it++)
@@ -475,12 +494,33 @@ TransactionChain EmbedData(const DataBits& data, uint64_t nBudget, const vector<
 			PackDataIntoNulldata(bits, txs[idx].vout.back());
 		}
 
+		/* Slice the data of all script hash outputs off first */
+		vector<P2SHSlices> slices(nScriptHash);
+		vector<DataBits> seqNrs(nScriptHash);
+		vector<DataBits> keyData;
+
+		for(unsigned int i = 0; i < nScriptHash; i++)
+		{
+			slices[i] = SliceDataForP2SH(bits);
+			seqNrs[i] = DataBits(bits.View(0, 32));
+			bits.Skip(32);
+
+			keyData.insert(keyData.end(), slices[i].keys.begin(), slices[i].keys.end());
+		}
+
+		/* Search for the data carrying public keys of the whole transaction at once */
+		vector<CPubKey> pubkeys = DataInterface::EncodeDataInPubkeys(keyData, 5);
+
 		/* Embed data in script hash outputs */
+		vector<CPubKey>::const_iterator itKey = pubkeys.begin();
 		for(unsigned int i = 0; i < nScriptHash; i++)
 		{
 			int n = txs[idx+1].vin[i].prevout.n;
-			PackDataIntoP2SH(bits, txs[idx].vout[n], txs[idx+1], i);
-			PackDataIntoSeqNr(bits, txs[idx+1].vin[i]);
+			vector<CPubKey> dataPubkeys(itKey, itKey + slices[i].keys.size());
+			itKey += slices[i].keys.size();
+
+			PackPubkeysIntoP2SH(slices[i].suffix, dataPubkeys, txs[idx].vout[n], txs[idx+1], i);
+			PackDataIntoSeqNr(seqNrs[i], txs[idx+1].vin[i]);
 		}
 
 		nBudget = nBudget - nFees;
@@ -514,7 +554,7 @@ DataBits ExtractData(const TransactionChain& txs)
 	const unsigned int nTransactions = txs.size();
 	vector<CTransaction> tmp = txs;
 
-	DataBits bits, slice;
+	DataBits bits;
 	CTxOut buf;
 
 	unsigned int nScriptHash;
@@ -534,29 +574,22 @@ DataBits ExtractData(const TransactionChain& txs)
 		/* Extract data from budget split and claim */
 		if(nScriptHash >= 2)
 		{
-			slice = UnpackDataFromBudgetSplit(tmp[idx].vout, 546);
-			bits.insert(bits.end(), slice.begin(), slice.end());
-
-			slice = UnpackDataFromBudgetClaim(tmp[idx+1].vin);
-			bits.insert(bits.end(), slice.begin(), slice.end());
+			UnpackDataFromBudgetSplit(tmp[idx].vout, 546, bits);
+			UnpackDataFromBudgetClaim(tmp[idx+1].vin, bits);
 		}
 
 		/* Extract data from Nulldata transaction output */
 		if(nNulldata)
 		{
-			slice = UnpackDataFromNulldata(buf);
-			bits.insert(bits.end(), slice.begin(), slice.end());
+			UnpackDataFromNulldata(buf, bits);
 		}
 
 
 		/* Extract data from P2SH transaction pairs */
 		for(unsigned int j = 0; j < nScriptHash; j++)
 		{
-			slice = UnpackDataFromP2SH(tmp[idx+1].vin[j]);
-			bits.insert(bits.end(), slice.begin(), slice.end());
-
-			slice = UnpackDataFromSeqNr(tmp[idx+1].vin[j]);
-			bits.insert(bits.end(), slice.begin(), slice.end());
+			UnpackDataFromP2SH(tmp[idx+1].vin[j], bits);
+			UnpackDataFromSeqNr(tmp[idx+1].vin[j], bits);
 
 		}
 	}
@@ -23,6 +23,11 @@ namespace BlockchainInterface
 		uint64_t budget;
 	};
 
+	struct P2SHSlices{
+		DataBits suffix;
+		std::vector<DataBits> keys;
+	};
+
 	struct Parameters{
 		unsigned int nScriptHash;
 		unsigned int nNulldata;
@@ -33,19 +38,21 @@ namespace BlockchainInterface
 	CBitcoinAddress SelectAddress();
 
 	void PackDataIntoP2SH(DataBits& data, CTxOut& txOut, CTransaction& tx, int nInput);
-	DataBits UnpackDataFromP2SH(const CTxIn& TxIn);
+	P2SHSlices SliceDataForP2SH(DataBits& data);
+	void PackPubkeysIntoP2SH(const DataBits& Suffix, const std::vector<CPubKey>& DataPubkeys, CTxOut& txOut, CTransaction& tx, int nInput);
+	void UnpackDataFromP2SH(const CTxIn& TxIn, DataBits& bits);
 
 	void PackDataIntoSeqNr(DataBits& data, CTxIn& txIn);
-	DataBits UnpackDataFromSeqNr(const CTxIn& TxIn);
+	void UnpackDataFromSeqNr(const CTxIn& TxIn, DataBits& bits);
 
 	void PackDataIntoNulldata(DataBits& data, CTxOut& txOut);
-	DataBits UnpackDataFromNulldata(const CTxOut& TxOut);
+	void UnpackDataFromNulldata(const CTxOut& TxOut, DataBits& bits);
 
 	void PackDataIntoBudgetSplit(DataBits& bits, std::vector<CTxOut>& txOuts, uint64_t budget, uint64_t lbound);
-	DataBits UnpackDataFromBudgetSplit(const std::vector<CTxOut>& TxOuts, uint64_t lbound);
+	void UnpackDataFromBudgetSplit(const std::vector<CTxOut>& TxOuts, uint64_t lbound, DataBits& bits);
 
 	void PackDataIntoBudgetClaim(DataBits& bits, std::vector<CTxIn>& txIns);
-	DataBits UnpackDataFromBudgetClaim(const std::vector<CTxIn>& TxIns);
+	void UnpackDataFromBudgetClaim(const std::vector<CTxIn>& TxIns, DataBits& bits);
 
 	void OptimizeParams(const CTransaction& Tx, const DataBits& Data, const uint64_t Budget, Parameters& params);
 	TransactionChain EmbedData(const DataBits& Data, uint64_t budget, const std::vector<COutPoint>& PrevOut, const CBitcoinAddress& Addr);
@@ -0,0 +1,707 @@
+/**
+ * CompressionBackend.cpp
+ *
+ * Interchangeable entropy coders for messages. Every backend
+ * identifies itself by an id that is written into a short header
+ * in front of the compressed data, so that the reader picks the
+ * matching decoder. Besides static Huffman coding there is a
+ * table-based rANS coder, which spends fractional bits per
+ * character and thus comes closer to the entropy of skewed text,
+ * an rANS coder with one table per preceding character, an
+ * LZ77 stage that references a preset dictionary ahead of any of
+ * the other coders and a choice of Huffman codes per message.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "CompressionBackend.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdexcept>
+#include <string.h>
+
+using std::vector;
+
+
+/**
+ * Creates a backend coding with a Huffman code.
+ * @param Codes Huffman coding of characters.
+ */
+HuffmanBackend::HuffmanBackend(const HuffCodeMap& Codes) :
+		encoder(Codes), decoder(Codes)
+{
+}
+
+/**
+ * Creates a backend coding with prebuilt tables of a Huffman code.
+ * @param Encoder Encoder of the Huffman code.
+ * @param Decoder Decoder of the same Huffman code.
+ */
+HuffmanBackend::HuffmanBackend(const HuffmanCoding::Encoder& Encoder, const HuffmanCoding::Decoder& Decoder) :
+		encoder(Encoder), decoder(Decoder)
+{
+}
+
+/**
+ * Compresses characters followed by the end-of-file character.
+ * @param Symbols To be compressed characters.
+ * @result Compressed data.
+ */
+DataBits HuffmanBackend::Compress(const Data& Symbols) const
+{
+	return encoder.Encode(Symbols);
+}
+
+/**
+ * Decompresses characters up to the end-of-file character.
+ * @param Bits To be decompressed data.
+ * @result Decompressed characters.
+ */
+Data HuffmanBackend::Decompress(const BitView& Bits) const
+{
+	return decoder.Decode(Bits);
+}
+
+/**
+ * Scales frequencies to a total of 2^ScaleBits, where every character keeps
+ * a frequency of at least one. Rounding errors are settled with the most
+ * frequent characters.
+ * @param Frequencies Frequency distribution of characters.
+ */
+RansTable::RansTable(const FreqMap& Frequencies)
+{
+	const uint32_t Total = 1 << ScaleBits;
+
+	memset(freq, 0, sizeof(freq));
+	memset(cumFreq, 0, sizeof(cumFreq));
+
+	uint64_t sum = 0;
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->second > 0)
+			sum += it->second;
+	}
+
+	if (sum == 0)
+		throw std::runtime_error("[RansTable] No character with a positive frequency");
+
+	uint32_t nScaled = 0;
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->second <= 0)
+			continue;
+
+		uint16_t& f = freq[(unsigned char) it->first];
+		f = std::max<uint64_t>(1, (uint64_t) it->second * Total / sum);
+		nScaled += f;
+	}
+
+	while (nScaled != Total)
+	{
+		uint16_t* pMax = std::max_element(freq, freq + 256);
+
+		if (nScaled < Total)
+		{
+			*pMax += Total - nScaled;
+			nScaled = Total;
+		}
+		else
+		{
+			(*pMax)--;
+			nScaled--;
+		}
+	}
+
+	uint32_t cum = 0;
+	for (int s = 0; s < 256; s++)
+	{
+		cumFreq[s] = cum;
+		memset(slotSymbol + cum, s, freq[s]);
+		cum += freq[s];
+	}
+}
+
+/**
+ * Returns the scaled frequencies, from which an identical table can be created.
+ * @result Frequency distribution of characters with a total of 2^ScaleBits.
+ */
+FreqMap RansTable::ScaledFrequencies() const
+{
+	FreqMap frequencies;
+
+	for (int s = 0; s < 256; s++)
+	{
+		if (freq[s] != 0)
+			frequencies[(char) s] = freq[s];
+	}
+
+	return frequencies;
+}
+
+/**
+ * Compresses characters followed by the end-of-file character, each with
+ * the table the model selects for the character preceding it. The first
+ * character is preceded by the end-of-file character. The state stays
+ * within [2^ScaleBits, 2^(ScaleBits+1)) and is renormalized one bit at a
+ * time, so a message costs the final state of ScaleBits bits on top of its
+ * entropy. The characters are coded in reverse, as the decoder reads them
+ * back in the opposite order.
+ * @param Symbols To be compressed characters.
+ * @param Tables Model providing the table of each context.
+ * @result Compressed data.
+ */
+template<typename Model>
+static DataBits RansEncode(const Data& Symbols, const Model& Tables)
+{
+	const uint32_t Total = 1 << RansTable::ScaleBits;
+	const unsigned char Eof = (unsigned char) EoF;
+
+	const RansTable& last = Tables.Table(Symbols.empty() ? Eof : Symbols.back());
+	if (last.freq[Eof] == 0)
+		throw std::out_of_range("[RansEncode] Character has no frequency");
+
+	/* The end-of-file character is decoded last, so no bits precede it */
+	uint32_t x = Total + last.cumFreq[Eof];
+	vector<bool> renorm;
+
+	for (size_t i = Symbols.size(); i-- > 0;)
+	{
+		const RansTable& table = Tables.Table(i > 0 ? Symbols[i - 1] : Eof);
+		const unsigned char s = Symbols[i];
+		const uint32_t f = table.freq[s];
+
+		if (f == 0)
+			throw std::out_of_range("[RansEncode] Character has no frequency");
+
+		while (x >= 2 * f)
+		{
+			renorm.push_back(x & 1);
+			x >>= 1;
+		}
+
+		x = Total + (x - f) + table.cumFreq[s];
+	}
+
+	DataBits bits;
+	bits.reserve(RansTable::ScaleBits + renorm.size());
+	bits.Append(x - Total, RansTable::ScaleBits);
+	bits.Append(renorm.rbegin(), renorm.rend());
+
+	return bits;
+}
+
+/**
+ * Decompresses characters up to the end-of-file character, or up to a
+ * character that would need bits behind the end of the data.
+ * @param Bits To be decompressed data.
+ * @param Tables Model providing the table of each context.
+ * @result Decompressed characters.
+ */
+template<typename Model>
+static Data RansDecode(const BitView& Bits, const Model& Tables)
+{
+	const uint32_t Total = 1 << RansTable::ScaleBits;
+	Data symbols;
+
+	if (Bits.size() < RansTable::ScaleBits)
+		return symbols;
+
+	uint32_t x = Total | Bits.Peek(0, RansTable::ScaleBits);
+	size_t pos = RansTable::ScaleBits;
+	unsigned char context = (unsigned char) EoF;
+
+	while (true)
+	{
+		const RansTable& table = Tables.Table(context);
+		const uint32_t slot = x & (Total - 1);
+		const unsigned char s = table.slotSymbol[slot];
+
+		if (s == (unsigned char) EoF)
+			break;
+
+		symbols.push_back(s);
+		x = table.freq[s] + slot - table.cumFreq[s];
+
+		unsigned int nBits = 0;
+		while ((x << nBits) < Total)
+			nBits++;
+
+		if (pos + nBits > Bits.size())
+			break;
+
+		x = (x << nBits) | Bits.Peek(pos, nBits);
+		pos += nBits;
+		context = s;
+	}
+
+	return symbols;
+}
+
+/**
+ * Creates a backend coding with rANS.
+ * @param Frequencies Frequency distribution of characters.
+ */
+RansBackend::RansBackend(const FreqMap& Frequencies) :
+		table(Frequencies)
+{
+}
+
+/**
+ * Compresses characters followed by the end-of-file character.
+ * @param Symbols To be compressed characters.
+ * @result Compressed data.
+ */
+DataBits RansBackend::Compress(const Data& Symbols) const
+{
+	return RansEncode(Symbols, *this);
+}
+
+/**
+ * Decompresses characters up to the end-of-file character.
+ * @param Bits To be decompressed data.
+ * @result Decompressed characters.
+ */
+Data RansBackend::Decompress(const BitView& Bits) const
+{
+	return RansDecode(Bits, *this);
+}
+
+/**
+ * Creates a backend coding with rANS and one table per preceding character.
+ * Every table can code all characters of the model, as characters that
+ * never followed a context get a frequency of one in its table. Contexts
+ * that never occurred share a table of the summed frequencies. Counts are
+ * summed and smoothed in 64 bits and scaled down to frequencies afterwards.
+ * @param Frequencies Frequency distributions of characters by their preceding character.
+ */
+ContextBackend::ContextBackend(const ContextFreqMap& Frequencies)
+{
+	Histogram counts;
+	counts.fill(0);
+	for (ContextFreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		for (FreqMap::const_iterator jt = it->second.begin(); jt != it->second.end(); jt++)
+		{
+			if (jt->second > 0)
+				counts[(unsigned char) jt->first] += jt->second;
+		}
+	}
+
+	FreqMap alphabet = HuffmanCoding::ComputeFrequencies(counts);
+	if (alphabet.empty())
+		throw std::runtime_error("[ContextBackend] No character with a positive frequency");
+
+	tables.reserve(Frequencies.size() + 1);
+	tables.push_back(RansTable(alphabet));
+	std::fill(tableIndex, tableIndex + 256, 0);
+
+	for (ContextFreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		Histogram smoothed;
+		smoothed.fill(0);
+		for (FreqMap::const_iterator jt = alphabet.begin(); jt != alphabet.end(); jt++)
+		{
+			FreqMap::const_iterator kt = it->second.find(jt->first);
+			if (kt != it->second.end() && kt->second > 0)
+				smoothed[(unsigned char) jt->first] = kt->second;
+			smoothed[(unsigned char) jt->first]++;
+		}
+
+		tableIndex[(unsigned char) it->first] = tables.size();
+		tables.push_back(RansTable(HuffmanCoding::ComputeFrequencies(smoothed)));
+	}
+}
+
+/**
+ * Compresses characters followed by the end-of-file character.
+ * @param Symbols To be compressed characters.
+ * @result Compressed data.
+ */
+DataBits ContextBackend::Compress(const Data& Symbols) const
+{
+	return RansEncode(Symbols, *this);
+}
+
+/**
+ * Decompresses characters up to the end-of-file character.
+ * @param Bits To be decompressed data.
+ * @result Decompressed characters.
+ */
+Data ContextBackend::Decompress(const BitView& Bits) const
+{
+	return RansDecode(Bits, *this);
+}
+
+/**
+ * Returns the number of bits needed to represent a number.
+ * @param Value The number.
+ * @result Position of the highest set bit plus one, zero for zero.
+ */
+static unsigned int BitWidth(uint64_t Value)
+{
+	unsigned int nBits = 0;
+	while (Value != 0)
+	{
+		nBits++;
+		Value >>= 1;
+	}
+
+	return nBits;
+}
+
+/**
+ * Appends a positive number in Elias gamma code, i.e. the number of its
+ * bits less one as zeros followed by the number itself.
+ * @param bits Data to be appended to.
+ * @param Value Number to be coded.
+ */
+static void AppendGamma(DataBits& bits, uint64_t Value)
+{
+	assert(Value > 0);
+
+	unsigned int nBits = BitWidth(Value);
+	bits.Append(0, nBits - 1);
+	bits.Append(Value, nBits);
+}
+
+/**
+ * Reads a positive number in Elias gamma code.
+ * @param Bits Coded data.
+ * @param pos Position of the number, advanced behind it.
+ * @result The number.
+ */
+static uint64_t ReadGamma(const BitView& Bits, size_t& pos)
+{
+	unsigned int nZeros = 0;
+	while (pos + nZeros < Bits.size() && nZeros < 64 && !Bits[pos + nZeros])
+		nZeros++;
+
+	if (nZeros == 64 || pos + 2 * nZeros + 1 > Bits.size())
+		throw std::runtime_error("[ReadGamma] Truncated number");
+
+	uint64_t value = Bits.Peek(pos + nZeros, nZeros + 1);
+	pos += 2 * nZeros + 1;
+
+	return value;
+}
+
+/**
+ * Computes the 32-bit FNV-1a hash of a text folded to 16 bits.
+ * @param Text The text.
+ * @result Hash of the text.
+ */
+static uint16_t HashText(const std::string& Text)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < Text.size(); i++)
+		hash = (hash ^ (unsigned char) Text[i]) * 16777619u;
+
+	return (uint16_t) ((hash >> 16) ^ hash);
+}
+
+const unsigned int DictionaryBackend::HashBits;
+
+/**
+ * Creates a backend that replaces repetitions of the dictionary or of the
+ * message itself by references and codes the remaining literals with
+ * another backend. The dictionary is indexed and hashed once.
+ * @param Dictionary Text that messages may reference.
+ * @param Literals Backend coding the literals.
+ */
+DictionaryBackend::DictionaryBackend(const std::string& Dictionary, const std::shared_ptr<const CompressionBackend>& Literals) :
+		finder(Dictionary), literals(Literals), hash(HashText(Dictionary))
+{
+	if (!literals)
+		throw std::runtime_error("[DictionaryBackend] No backend for the literals");
+}
+
+/**
+ * Compresses characters followed by the end-of-file character. The data
+ * starts with a hash of the dictionary, which a reader with another
+ * dictionary rejects, and the number of tokens, followed by every token as
+ * the length of its literal run and, but for the last token, the length
+ * and distance of its match. Lengths are gamma coded, whereas a distance
+ * takes as many bits as the largest distance possible at its position.
+ * The literals follow, coded by the literal backend.
+ * @param Symbols To be compressed characters.
+ * @result Compressed data.
+ */
+DataBits DictionaryBackend::Compress(const Data& Symbols) const
+{
+	const vector<MatchFinder::Token> tokens = finder.Parse(Symbols);
+	const size_t nDict = finder.Dictionary().size();
+
+	DataBits bits;
+	Data literalSymbols;
+	size_t pos = 0;
+
+	bits.Append(hash, HashBits);
+	AppendGamma(bits, tokens.size());
+
+	for (size_t i = 0; i < tokens.size(); i++)
+	{
+		const MatchFinder::Token& token = tokens[i];
+
+		AppendGamma(bits, token.nLiterals + 1);
+		literalSymbols.insert(literalSymbols.end(), Symbols.begin() + pos, Symbols.begin() + pos + token.nLiterals);
+		pos += token.nLiterals;
+
+		if (i + 1 == tokens.size())
+			break;
+
+		AppendGamma(bits, token.length - MatchFinder::MinMatch + 1);
+		bits.Append(token.distance - 1, BitWidth(nDict + pos - 1));
+		pos += token.length;
+	}
+
+	bits.Append(literals->Compress(literalSymbols));
+
+	return bits;
+}
+
+/**
+ * Decompresses characters up to the end-of-file character. Data written
+ * with another dictionary is rejected.
+ * @param Bits To be decompressed data.
+ * @result Decompressed characters.
+ */
+Data DictionaryBackend::Decompress(const BitView& Bits) const
+{
+	const size_t nDict = finder.Dictionary().size();
+	size_t pos = HashBits, nSymbols = 0;
+
+	if (Bits.size() < HashBits)
+		throw std::runtime_error("[DictionaryBackend] Corrupt data");
+
+	if (Bits.Peek(0, HashBits) != hash)
+		throw std::runtime_error("[DictionaryBackend] Data was written with another dictionary");
+
+	const uint64_t nTokens = ReadGamma(Bits, pos);
+	if (nTokens > Bits.size())
+		throw std::runtime_error("[DictionaryBackend] Corrupt data");
+
+	vector<MatchFinder::Token> tokens(nTokens);
+	for (size_t i = 0; i < nTokens; i++)
+	{
+		MatchFinder::Token& token = tokens[i];
+
+		token.nLiterals = ReadGamma(Bits, pos) - 1;
+		token.length = 0;
+		token.distance = 0;
+
+		if (token.nLiterals > Bits.size())
+			throw std::runtime_error("[DictionaryBackend] Corrupt data");
+		nSymbols += token.nLiterals;
+
+		if (i + 1 == nTokens)
+			break;
+
+		token.length = ReadGamma(Bits, pos) - 1 + MatchFinder::MinMatch;
+		if (token.length > MatchFinder::MaxMatch)
+			throw std::runtime_error("[DictionaryBackend] Corrupt data");
+
+		const unsigned int nDistanceBits = BitWidth(nDict + nSymbols - 1);
+		if (pos + nDistanceBits > Bits.size())
+			throw std::runtime_error("[DictionaryBackend] Corrupt data");
+
+		token.distance = Bits.Peek(pos, nDistanceBits) + 1;
+		pos += nDistanceBits;
+		nSymbols += token.length;
+	}
+
+	const Data literalSymbols = literals->Decompress(Bits.Sub(pos, Bits.size() - pos));
+
+	return finder.Expand(tokens, literalSymbols);
+}
+
+/**
+ * Creates the Huffman backends of codes, leaving unused ids empty.
+ * @param Tables Huffman codings of characters, empty for unused ids.
+ * @result Backends by their id.
+ */
+static vector<std::shared_ptr<const HuffmanBackend> > CreateTables(const vector<HuffCodeMap>& Tables)
+{
+	vector<std::shared_ptr<const HuffmanBackend> > tables(Tables.size());
+
+	for (size_t i = 0; i < Tables.size(); i++)
+	{
+		if (!Tables[i].empty())
+			tables[i] = std::make_shared<HuffmanBackend>(Tables[i]);
+	}
+
+	return tables;
+}
+
+/**
+ * Creates a backend that codes every message with the Huffman code that
+ * compresses it best. The position of a code is its id.
+ * @param Tables Huffman codings of characters, empty for unused ids.
+ */
+MultiTableBackend::MultiTableBackend(const vector<HuffCodeMap>& Tables) :
+		MultiTableBackend(CreateTables(Tables))
+{
+}
+
+/**
+ * Creates a backend that codes every message with the Huffman backend that
+ * compresses it best, sharing the given backends and their tables. The
+ * position of a backend is its id.
+ * @param Tables Huffman backends, null for unused ids.
+ */
+MultiTableBackend::MultiTableBackend(const vector<std::shared_ptr<const HuffmanBackend> >& Tables) :
+		tables(Tables), lengths(Tables.size())
+{
+	if (Tables.empty() || Tables.size() > (1u << TableBits))
+		throw std::runtime_error("[MultiTableBackend] Invalid number of codes");
+
+	for (size_t i = 0; i < Tables.size(); i++)
+	{
+		lengths[i].fill(0);
+
+		if (!Tables[i])
+			continue;
+
+		const HuffmanCoding::Encoder& encoder = Tables[i]->GetEncoder();
+		for (int c = 0; c < 256; c++)
+			lengths[i][c] = encoder.Length((char) c);
+	}
+}
+
+/**
+ * Selects the code that compresses characters into the fewest bits. The
+ * characters are counted once, and the size under every code follows from
+ * its code lengths, so only the chosen code needs to encode them.
+ * @param Symbols To be compressed characters.
+ * @result Id of the code, the lowest of equally good ones.
+ */
+size_t MultiTableBackend::SelectTable(const Data& Symbols) const
+{
+	Histogram counts;
+	counts.fill(0);
+	HuffmanCoding::AccumulateHistogram(counts, (const char*) Symbols.data(), Symbols.size());
+	counts[(unsigned char) EoF]++;
+
+	size_t best = tables.size();
+	uint64_t nBestBits = 0;
+
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		if (!tables[i])
+			continue;
+
+		uint64_t nBits = 0;
+		bool bComplete = true;
+
+		for (int c = 0; c < 256 && bComplete; c++)
+		{
+			if (counts[c] == 0)
+				continue;
+
+			bComplete = (lengths[i][c] != 0);
+			nBits += counts[c] * lengths[i][c];
+		}
+
+		if (bComplete && (best == tables.size() || nBits < nBestBits))
+		{
+			best = i;
+			nBestBits = nBits;
+		}
+	}
+
+	if (best == tables.size())
+		throw std::out_of_range("[MultiTableBackend] No code for all characters");
+
+	return best;
+}
+
+/**
+ * Compresses characters followed by the end-of-file character with the
+ * best code, whose id is put in front.
+ * @param Symbols To be compressed characters.
+ * @result Compressed data.
+ */
+DataBits MultiTableBackend::Compress(const Data& Symbols) const
+{
+	const size_t id = SelectTable(Symbols);
+
+	DataBits bits;
+	bits.Append(id, TableBits);
+	bits.Append(tables[id]->Compress(Symbols));
+
+	return bits;
+}
+
+/**
+ * Decompresses characters up to the end-of-file character with the code
+ * named in front.
+ * @param Bits To be decompressed data.
+ * @result Decompressed characters.
+ */
+Data MultiTableBackend::Decompress(const BitView& Bits) const
+{
+	if (Bits.size() < TableBits)
+		throw std::runtime_error("[MultiTableBackend] Data too short for a code id");
+
+	const size_t id = Bits.Peek(0, TableBits);
+	if (id >= tables.size() || !tables[id])
+		throw std::runtime_error("[MultiTableBackend] Code not available");
+
+	return tables[id]->Decompress(Bits.Sub(TableBits, Bits.size() - TableBits));
+}
+
+namespace Compression
+{
+
+/**
+ * Looks up a backend by its id.
+ * @param Backends Available backends.
+ * @param Id Id of the backend.
+ * @result The backend with the id.
+ */
+const CompressionBackend& FindBackend(const BackendList& Backends, BackendId Id)
+{
+	for (BackendList::const_iterator it = Backends.begin(); it != Backends.end(); it++)
+	{
+		if ((*it)->Id() == Id)
+			return **it;
+	}
+
+	throw std::runtime_error("[FindBackend] Compression backend not available");
+}
+
+/**
+ * Compresses characters with a backend and puts its id in front.
+ * @param Symbols To be compressed characters.
+ * @param Backend Backend to be used.
+ * @result Header followed by the compressed data.
+ */
+DataBits Compress(const Data& Symbols, const CompressionBackend& Backend)
+{
+	DataBits bits;
+
+	bits.Append(Backend.Id(), HeaderBits);
+	bits.Append(Backend.Compress(Symbols));
+
+	return bits;
+}
+
+/**
+ * Decompresses data with the backend named in its header.
+ * @param Bits Header followed by the compressed data.
+ * @param Backends Available backends.
+ * @result Decompressed vector of characters.
+ */
+Data Decompress(const DataBits& Bits, const BackendList& Backends)
+{
+	if (Bits.size() < HeaderBits)
+		throw std::runtime_error("[Decompress] Data too short for a header");
+
+	const BackendId Id = (BackendId) Bits.Peek(0, HeaderBits);
+
+	return FindBackend(Backends, Id).Decompress(Bits.View(HeaderBits, Bits.size() - HeaderBits));
+}
+
+}
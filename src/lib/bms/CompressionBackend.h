@@ -0,0 +1,166 @@
+/**
+ * CompressionBackend.h
+ *
+ * Interchangeable entropy coders for messages. Every backend
+ * identifies itself by an id that is written into a short header
+ * in front of the compressed data, so that the reader picks the
+ * matching decoder. Besides static Huffman coding there is a
+ * table-based rANS coder, which spends fractional bits per
+ * character and thus comes closer to the entropy of skewed text,
+ * an rANS coder with one table per preceding character, an
+ * LZ77 stage that references a preset dictionary ahead of any of
+ * the other coders and a choice of Huffman codes per message.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_COMPRESSIONBACKEND_H
+#define BMS_COMPRESSIONBACKEND_H
+
+#include "DataCompression.h"
+#include "MatchFinder.h"
+#include "Types.h"
+
+#include <array>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+enum BackendId : uint8_t
+{
+	BACKEND_HUFFMAN = 0,
+	BACKEND_RANS = 1,
+	BACKEND_CONTEXT = 2,
+	BACKEND_DICTIONARY = 3,
+	BACKEND_TABLES = 4
+};
+
+class CompressionBackend
+{
+public:
+	virtual ~CompressionBackend() { }
+
+	virtual BackendId Id() const = 0;
+	virtual DataBits Compress(const Data& Symbols) const = 0;
+	virtual Data Decompress(const BitView& Bits) const = 0;
+};
+
+class HuffmanBackend: public CompressionBackend
+{
+public:
+	explicit HuffmanBackend(const HuffCodeMap& Codes);
+	HuffmanBackend(const HuffmanCoding::Encoder& Encoder, const HuffmanCoding::Decoder& Decoder);
+
+	BackendId Id() const { return BACKEND_HUFFMAN; }
+	DataBits Compress(const Data& Symbols) const;
+	Data Decompress(const BitView& Bits) const;
+
+	const HuffmanCoding::Encoder& GetEncoder() const { return encoder; }
+
+private:
+	HuffmanCoding::Encoder encoder;
+	HuffmanCoding::Decoder decoder;
+};
+
+/* Frequencies of an rANS coder scaled to a total of 2^ScaleBits */
+struct RansTable
+{
+	static const unsigned int ScaleBits = 12;
+
+	explicit RansTable(const FreqMap& Frequencies);
+
+	FreqMap ScaledFrequencies() const;
+
+	uint16_t freq[256];
+	uint16_t cumFreq[256];
+	uint8_t slotSymbol[1 << ScaleBits];
+};
+
+class RansBackend: public CompressionBackend
+{
+public:
+	explicit RansBackend(const FreqMap& Frequencies);
+
+	BackendId Id() const { return BACKEND_RANS; }
+	DataBits Compress(const Data& Symbols) const;
+	Data Decompress(const BitView& Bits) const;
+
+	FreqMap ScaledFrequencies() const { return table.ScaledFrequencies(); }
+
+	const RansTable& Table(unsigned char) const { return table; }
+
+private:
+	RansTable table;
+};
+
+class ContextBackend: public CompressionBackend
+{
+public:
+	explicit ContextBackend(const ContextFreqMap& Frequencies);
+
+	BackendId Id() const { return BACKEND_CONTEXT; }
+	DataBits Compress(const Data& Symbols) const;
+	Data Decompress(const BitView& Bits) const;
+
+	const RansTable& Table(unsigned char Context) const { return tables[tableIndex[Context]]; }
+
+private:
+	/* Tables of the seen contexts, preceded by the one of unseen contexts */
+	std::vector<RansTable> tables;
+	uint16_t tableIndex[256];
+};
+
+class DictionaryBackend: public CompressionBackend
+{
+public:
+	/* Number of bits of the hash identifying the dictionary */
+	static const unsigned int HashBits = 16;
+
+	DictionaryBackend(const std::string& Dictionary, const std::shared_ptr<const CompressionBackend>& Literals);
+
+	BackendId Id() const { return BACKEND_DICTIONARY; }
+	DataBits Compress(const Data& Symbols) const;
+	Data Decompress(const BitView& Bits) const;
+
+private:
+	MatchFinder finder;
+	std::shared_ptr<const CompressionBackend> literals;
+	uint16_t hash;
+};
+
+class MultiTableBackend: public CompressionBackend
+{
+public:
+	/* Number of bits of the id of the chosen code */
+	static const unsigned int TableBits = 4;
+
+	explicit MultiTableBackend(const std::vector<HuffCodeMap>& Tables);
+	explicit MultiTableBackend(const std::vector<std::shared_ptr<const HuffmanBackend> >& Tables);
+
+	BackendId Id() const { return BACKEND_TABLES; }
+	DataBits Compress(const Data& Symbols) const;
+	Data Decompress(const BitView& Bits) const;
+
+	size_t SelectTable(const Data& Symbols) const;
+
+private:
+	/* Codes by their id, empty for ids without a code */
+	std::vector<std::shared_ptr<const HuffmanBackend> > tables;
+	std::vector<std::array<uint8_t, 256> > lengths;
+};
+
+typedef std::vector<std::shared_ptr<const CompressionBackend> > BackendList;
+
+namespace Compression
+{
+	/* Number of bits of the header holding the backend id */
+	const unsigned int HeaderBits = 4;
+
+	const CompressionBackend& FindBackend(const BackendList& Backends, BackendId Id);
+
+	DataBits Compress(const Data& Symbols, const CompressionBackend& Backend);
+	Data Decompress(const DataBits& Bits, const BackendList& Backends);
+};
+
+#endif
@@ -10,13 +10,20 @@
  */
 
 #include <algorithm>
-#include <queue>
+#include <climits>
 #include <iterator>
 #include <iostream>
+#include <stdexcept>
+#include <string.h>
 
 #include "DataCompression.h"
 #include "Utilities.h"
 
+#if defined(__SSE2__)
+#define BMS_SSE2_FILTER
+#include <emmintrin.h>
+#endif
+
 using std::map;
 using std::vector;
 using std::string;
@@ -26,53 +33,15 @@ using std::remove_if;
 namespace HuffmanCoding
 {
 
-class BaseNode
-{
-public:
-	const int frequency;
-
-	BaseNode(int freq) : frequency(freq) { }
-	virtual ~BaseNode() { }
-};
-
-class InternalNode: public BaseNode
-{
-public:
-	BaseNode *left;
-	BaseNode *right;
+/* Index width of the primary and secondary decoding tables */
+static const unsigned int PrimaryBits = 10;
+static const unsigned int SecondaryBits = 6;
 
-	InternalNode(BaseNode *node1, BaseNode *node2) :
-			BaseNode(node1->frequency + node2->frequency)
-	{
-		left = node1;
-		right = node2;
-	};
-
-	~InternalNode()
-	{
-		delete left;
-		delete right;
-	}
-};
+/* Longest code the decoding window can hold */
+static const unsigned int MaxDecodeBits = 64;
 
-class LeafNode: public BaseNode
-{
-public:
-	const char character;
-
-	LeafNode(char sym, int freq) :
-			BaseNode(freq), character(sym)
-	{
-	}
-};
-
-struct NodeCmp
-{
-	bool operator()(const BaseNode* left, const BaseNode* right) const
-	{
-		return left->frequency > right->frequency;
-	}
-};
+/* Number of distinct characters */
+static const size_t MaxSymbols = 256;
 
 bool IsCharInvalid(const char symbol)
 {
@@ -114,13 +83,94 @@ bool IsCharInvalid(const char symbol)
 
 }
 
+/* Whether a character adheres to the restricted alphabet, indexed by its byte */
+static std::array<unsigned char, 256> BuildValidChars()
+{
+	std::array<unsigned char, 256> valid;
+
+	for (int c = 0; c < 256; c++)
+		valid[c] = !IsCharInvalid((char) c);
+
+	return valid;
+}
+
+static const std::array<unsigned char, 256> ValidChars = BuildValidChars();
+
+/**
+ * Filters characters with the lookup table. Every character is written to
+ * the output position, which only advances behind valid characters.
+ * @param pIn Characters to be filtered.
+ * @param nChars Number of characters.
+ * @param pOut Output position, which may equal the input position.
+ * @result Number of remaining characters.
+ */
+static size_t FilterScalar(const char* pIn, size_t nChars, char* pOut)
+{
+	size_t nOut = 0;
+
+	for (size_t i = 0; i < nChars; i++)
+	{
+		const char ch = pIn[i];
+		pOut[nOut] = ch;
+		nOut += ValidChars[(unsigned char) ch];
+	}
+
+	return nOut;
+}
+
+/**
+ * Removes characters that do not adhere to a restricted alphabet from a
+ * buffer, moving the remaining characters to its front. Blocks of 16
+ * characters are checked at once, and blocks without invalid characters
+ * are moved as a whole, whereas the others fall back to the lookup table.
+ * @param pText Characters to be filtered.
+ * @param nChars Number of characters.
+ * @result Number of remaining characters.
+ */
+size_t FilterCharDomain(char* pText, size_t nChars)
+{
+	size_t i = 0, nOut = 0;
+
+#ifdef BMS_SSE2_FILTER
+	/* Ranges of the alphabet, shifted so that signed comparisons apply */
+	const __m128i Bias = _mm_set1_epi8(-128);
+	const __m128i SignsLow = _mm_set1_epi8(0x20 - 1 - 128);
+	const __m128i SignsHigh = _mm_set1_epi8(0x5A + 1 - 128);
+	const __m128i LowerLow = _mm_set1_epi8(0x61 - 1 - 128);
+	const __m128i LowerHigh = _mm_set1_epi8(0x7A + 1 - 128);
+	const __m128i Newline = _mm_set1_epi8(0x0A);
+
+	for (; i + 16 <= nChars; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(pText + i));
+		__m128i s = _mm_xor_si128(x, Bias);
+
+		__m128i valid = _mm_and_si128(_mm_cmpgt_epi8(s, SignsLow), _mm_cmplt_epi8(s, SignsHigh));
+		valid = _mm_or_si128(valid, _mm_and_si128(_mm_cmpgt_epi8(s, LowerLow), _mm_cmplt_epi8(s, LowerHigh)));
+		valid = _mm_or_si128(valid, _mm_cmpeq_epi8(x, Newline));
+
+		if (_mm_movemask_epi8(valid) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i*)(pText + nOut), x);
+			nOut += 16;
+		}
+		else
+		{
+			nOut += FilterScalar(pText + i, 16, pText + nOut);
+		}
+	}
+#endif
+
+	return nOut + FilterScalar(pText + i, nChars - i, pText + nOut);
+}
+
 /**
  * Removes characters that do not adhere to a restricted alphabet.
  * @param text String to be transformed.
  */
 void TransformCharDomain(string& text)
 {
-	text.erase(remove_if(text.begin(), text.end(), &IsCharInvalid), text.end());
+	text.resize(FilterCharDomain(&text[0], text.size()));
 }
 
 /**
@@ -130,77 +180,350 @@ void TransformCharDomain(string& text)
  */
 FreqMap ComputeFrequencies(const string& Text)
 {
+	Histogram counts;
+	counts.fill(0);
+
+	AccumulateHistogram(counts, Text.data(), Text.size());
+
+	return ComputeFrequencies(counts);
+}
+
+/**
+ * Computes the frequency distribution of the characters counted in a
+ * histogram. Counts too large for a frequency are scaled down evenly,
+ * where every counted character keeps a frequency of at least one.
+ * @param Counts Number of occurrences of every character.
+ * @result Frequency map of the counted characters.
+ */
+FreqMap ComputeFrequencies(const Histogram& Counts)
+{
+	const uint64_t nMax = *std::max_element(Counts.begin(), Counts.end());
+	const uint64_t divisor = nMax / INT_MAX + 1;
+
 	FreqMap frequencies;
+	for (int c = 0; c < 256; c++)
+	{
+		if (Counts[c] != 0)
+			frequencies[(char) c] = (Counts[c] + divisor - 1) / divisor;
+	}
+
+	return frequencies;
+}
+
+/**
+ * Adds the characters of a text to a histogram. Consecutive characters are
+ * counted in separate banks, so that repeated characters do not wait on
+ * the increment of their predecessor.
+ * @param counts Histogram to be added to.
+ * @param pText Characters to be counted.
+ * @param nChars Number of characters.
+ */
+void AccumulateHistogram(Histogram& counts, const char* pText, size_t nChars)
+{
+	const unsigned char* p = (const unsigned char*) pText;
+	uint32_t banks[4][256];
+	memset(banks, 0, sizeof(banks));
+
+	/* Banks are flushed before their counts can overflow */
+	const size_t BlockSize = (size_t) 1 << 30;
+
+	while (nChars > 0)
+	{
+		const size_t nBlock = std::min(nChars, BlockSize);
+
+		size_t i = 0;
+		for (; i + 4 <= nBlock; i += 4)
+		{
+			banks[0][p[i]]++;
+			banks[1][p[i + 1]]++;
+			banks[2][p[i + 2]]++;
+			banks[3][p[i + 3]]++;
+		}
+		for (; i < nBlock; i++)
+			banks[0][p[i]]++;
+
+		for (int c = 0; c < 256; c++)
+		{
+			counts[c] += (uint64_t) banks[0][c] + banks[1][c] + banks[2][c] + banks[3][c];
+			banks[0][c] = banks[1][c] = banks[2][c] = banks[3][c] = 0;
+		}
+
+		p += nBlock;
+		nChars -= nBlock;
+	}
+}
+
+/**
+ * Computes the frequency distribution of characters by their preceding
+ * character. A text is taken to be preceded and followed by the
+ * end-of-file character, so that both the first character and the end of
+ * the text are accounted for.
+ * @param Text Input text.
+ * @result Frequency distributions of characters by their preceding character.
+ */
+ContextFreqMap ComputeContextFrequencies(const string& Text)
+{
+	ContextFreqMap frequencies;
+	char context = EoF;
 
 	for (string::const_iterator it = Text.begin(); it != Text.end(); it++)
 	{
-		frequencies[*it]++;
+		frequencies[context][*it]++;
+		context = *it;
 	}
 
+	frequencies[context][EoF]++;
+
 	return frequencies;
 }
 
-BaseNode* BuildTree(const FreqMap& Frequencies)
+/**
+ * Generates the Huffman coding from a given frequency distribution.
+ * @param Frequencies Frequency distribution of characters.
+ * @result Corresponding canonical Huffman coding of characters.
+ */
+HuffCodeMap GenerateCodes(const FreqMap& Frequencies)
+{
+	return GenerateCanonicalCodes(ComputeCodeLengths(Frequencies));
+}
+
+/* Code of a character, right-aligned in the lower bits */
+struct CanonicalCode
+{
+	unsigned char symbol;
+	unsigned int nBits;
+	uint64_t code;
+};
+
+/**
+ * Assigns canonical codes to code lengths. Characters are ordered by code
+ * length and then by byte value, and each code is the successor of the
+ * previous one, extended with zero's to its length.
+ * @param Lengths Code lengths of characters.
+ * @result Codes of the characters in canonical order.
+ */
+static vector<CanonicalCode> AssignCanonicalCodes(const CodeLengthMap& Lengths)
 {
-	std::priority_queue<BaseNode*, vector<BaseNode*>, NodeCmp> tree;
+	vector<CanonicalCode> codes;
+
+	for (CodeLengthMap::const_iterator it = Lengths.begin(); it != Lengths.end(); it++)
+	{
+		if (it->second == 0 || it->second > MaxDecodeBits)
+			throw std::runtime_error("[AssignCanonicalCodes] Invalid code length");
+
+		CanonicalCode code = {(unsigned char) it->first, it->second, 0};
+		codes.push_back(code);
+	}
 
-	for (FreqMap::const_iterator it = Frequencies.begin();
-			it != Frequencies.end(); it++)
+	std::sort(codes.begin(), codes.end(), [](const CanonicalCode& a, const CanonicalCode& b)
 	{
-		tree.push(new LeafNode(it->first, it->second));
+		return a.nBits < b.nBits || (a.nBits == b.nBits && a.symbol < b.symbol);
+	});
+
+	uint64_t next = 0;
+	unsigned int nPrevBits = codes.empty() ? 0 : codes.front().nBits;
+
+	for (vector<CanonicalCode>::iterator it = codes.begin(); it != codes.end(); it++)
+	{
+		next <<= (it->nBits - nPrevBits);
+		nPrevBits = it->nBits;
+
+		if (nPrevBits < MaxDecodeBits && (next >> nPrevBits) != 0)
+			throw std::runtime_error("[AssignCanonicalCodes] Code lengths exceed the code space");
+
+		it->code = next++;
 	}
 
-	while (tree.size() > 1)
+	return codes;
+}
+
+/**
+ * Computes optimal code lengths from a given frequency distribution,
+ * optionally limited to a maximum length.
+ * @param Frequencies Frequency distribution of characters.
+ * @param nMaxBits Maximum code length, or zero for no limit.
+ * @result Code lengths of the characters.
+ */
+CodeLengthMap ComputeCodeLengths(const FreqMap& Frequencies, unsigned int nMaxBits)
+{
+	const size_t nLeaves = Frequencies.size();
+	CodeLengthMap lengths;
+
+	if (nLeaves == 0)
+		return lengths;
+
+	/* Leaves sorted by frequency come first, followed by the internal nodes */
+	std::pair<uint64_t, unsigned char> leaves[MaxSymbols];
+	uint64_t weight[2 * MaxSymbols];
+	uint16_t parent[2 * MaxSymbols];
+	uint16_t depth[2 * MaxSymbols];
+
+	size_t n = 0;
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+		leaves[n++] = std::make_pair((uint64_t) std::max(it->second, 0), (unsigned char) it->first);
+
+	std::sort(leaves, leaves + nLeaves);
+	for (size_t i = 0; i < nLeaves; i++)
+		weight[i] = leaves[i].first;
+
+	/*
+	 * Internal nodes are created in ascending order of weight, so the two
+	 * lightest nodes are always at the front of either the leaves or the
+	 * internal nodes. Ties go to the leaves, which keeps the tree shallow.
+	 */
+	size_t nNextLeaf = 0;
+	size_t nNextNode = nLeaves;
+	size_t nNodes = nLeaves;
+
+	for (size_t i = 1; i < nLeaves; i++)
 	{
-		BaseNode *childLeft = tree.top();
-		tree.pop();
+		size_t children[2];
+		for (int j = 0; j < 2; j++)
+		{
+			if (nNextLeaf < nLeaves && (nNextNode == nNodes || weight[nNextLeaf] <= weight[nNextNode]))
+				children[j] = nNextLeaf++;
+			else
+				children[j] = nNextNode++;
+
+			parent[children[j]] = nNodes;
+		}
+
+		weight[nNodes++] = weight[children[0]] + weight[children[1]];
+	}
+
+	/* Parents come after their children, so depths follow from the root down */
+	depth[nNodes - 1] = 0;
+	for (size_t i = nNodes - 1; i-- > 0;)
+		depth[i] = depth[parent[i]] + 1;
+
+	/* A single character still needs one bit to be decodable */
+	for (size_t i = 0; i < nLeaves; i++)
+		lengths[(char) leaves[i].second] = std::max<unsigned int>(depth[i], 1);
+
+	if (nMaxBits != 0)
+		LimitCodeLengths(lengths, nMaxBits);
 
-		BaseNode *childRight = tree.top();
-		tree.pop();
+	return lengths;
+}
 
-		BaseNode *parent = new InternalNode(childLeft, childRight);
+/**
+ * Extracts the code lengths of a Huffman coding.
+ * @param Codes Huffman coding of characters.
+ * @result Code lengths of the characters.
+ */
+CodeLengthMap GetCodeLengths(const HuffCodeMap& Codes)
+{
+	CodeLengthMap lengths;
 
-		tree.push(parent);
+	for (HuffCodeMap::left_const_iterator it = Codes.left.begin(); it != Codes.left.end(); it++)
+	{
+		lengths[it->first] = it->second.size();
 	}
 
-	return tree.top();
+	return lengths;
 }
 
-void GenerateCodes(const BaseNode *Node, const HuffCode& Prefix, HuffCodeMap& codes)
+/**
+ * Limits code lengths to a maximum length while keeping the code complete.
+ * Codes over the limit are cut down to it and the excess in code space is
+ * paid back by lengthening the longest codes below the limit. The lengths
+ * are finally handed out again in the previous order of the characters, so
+ * that shorter codes stay with characters that had shorter codes before.
+ * @param lengths Code lengths of characters.
+ * @param nMaxBits Maximum code length.
+ */
+void LimitCodeLengths(CodeLengthMap& lengths, unsigned int nMaxBits)
 {
-	if (const LeafNode* lf = dynamic_cast<const LeafNode*>(Node))
+	if (nMaxBits == 0 || nMaxBits >= MaxDecodeBits)
+		throw std::runtime_error("[LimitCodeLengths] Invalid maximum code length");
+
+	if (lengths.size() > (1ULL << nMaxBits))
+		throw std::runtime_error("[LimitCodeLengths] Maximum code length too short for all characters");
+
+	vector<std::pair<unsigned int, unsigned char> > order;
+	vector<uint64_t> count(nMaxBits + 1, 0);
+	bool bExceeds = false;
+
+	for (CodeLengthMap::const_iterator it = lengths.begin(); it != lengths.end(); it++)
 	{
-		codes.insert(HuffCodeMap::value_type(lf->character, Prefix));
+		order.push_back(std::make_pair(it->second, (unsigned char) it->first));
+		count[std::min(it->second, nMaxBits)]++;
+		bExceeds |= (it->second > nMaxBits);
 	}
-	else if (const InternalNode* in = dynamic_cast<const InternalNode*>(Node))
+
+	if (!bExceeds)
+		return;
+
+	/* Code space used, in units of the longest code */
+	uint64_t total = 0;
+	for (unsigned int i = 1; i <= nMaxBits; i++)
+		total += count[i] << (nMaxBits - i);
+
+	/* Move a code off the longest level by splitting the deepest shorter code */
+	while (total > (1ULL << nMaxBits))
 	{
+		count[nMaxBits]--;
+		for (unsigned int i = nMaxBits - 1; i > 0; i--)
+		{
+			if (count[i] != 0)
+			{
+				count[i]--;
+				count[i + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
 
-		HuffCode leftPrefix = Prefix;
-		leftPrefix.push_back(false);
-		GenerateCodes(in->left, leftPrefix, codes);
+	std::sort(order.begin(), order.end());
 
-		HuffCode rightPrefix = Prefix;
-		rightPrefix.push_back(true);
-		GenerateCodes(in->right, rightPrefix, codes);
+	vector<std::pair<unsigned int, unsigned char> >::const_iterator it = order.begin();
+	for (unsigned int i = 1; i <= nMaxBits; i++)
+	{
+		for (uint64_t j = 0; j < count[i]; j++, it++)
+			lengths[(char) it->second] = i;
 	}
 }
 
 /**
- * Generates the Huffman coding from a given frequency distribution.
- * @param Frequencies Frequency distribution of characters.
- * @result Corresponding Huffman coding of characters.
+ * Generates the canonical Huffman coding for given code lengths.
+ * @param Lengths Code lengths of characters.
+ * @result Canonical Huffman coding of the characters.
  */
-HuffCodeMap GenerateCodes(const FreqMap& Frequencies)
+HuffCodeMap GenerateCanonicalCodes(const CodeLengthMap& Lengths)
 {
-	BaseNode* root = BuildTree(Frequencies);
+	vector<CanonicalCode> canonical = AssignCanonicalCodes(Lengths);
 	HuffCodeMap codes;
 
-	GenerateCodes(root, HuffCode(), codes);
-	delete root;
+	for (vector<CanonicalCode>::const_iterator it = canonical.begin(); it != canonical.end(); it++)
+	{
+		HuffCode code(it->nBits);
+		for (unsigned int i = 0; i < it->nBits; i++)
+			code[i] = (it->code >> (it->nBits - 1 - i)) & 1;
+
+		codes.insert(HuffCodeMap::value_type((char) it->symbol, code));
+	}
 
 	return codes;
 }
 
+/**
+ * Checks whether a Huffman coding is the canonical one of its code lengths.
+ * @param Codes Huffman coding of characters.
+ * @result True if the coding is canonical. Otherwise not.
+ */
+bool IsCanonical(const HuffCodeMap& Codes)
+{
+	try
+	{
+		return GenerateCanonicalCodes(GetCodeLengths(Codes)) == Codes;
+	}
+	catch (std::runtime_error& e)
+	{
+		return false;
+	}
+}
+
 /**
  * Compresses a vector of characters using Huffman coding.
  * @param Data To be compressed data.
@@ -209,16 +532,219 @@ HuffCodeMap GenerateCodes(const FreqMap& Frequencies)
  */
 DataBits Compress(const Data& Data, const HuffCodeMap& Codes)
 {
-	DataBits compData;
+	return Encoder(Codes).Encode(Data);
+}
 
-	for (Data::const_iterator it = Data.begin(); it != Data.end(); it++)
+/**
+ * Compresses a vector of characters with a prebuilt encoder.
+ * @param Data To be compressed data.
+ * @param Codes Encoder of the Huffman coding.
+ * @result Compressed vector of characters.
+ */
+DataBits Compress(const Data& Data, const Encoder& Codes)
+{
+	return Codes.Encode(Data);
+}
+
+const unsigned int Encoder::MaxCodeBits;
+
+/** Creates an encoder without any codes. */
+Encoder::Encoder() : nCodes(0)
+{
+	Codeword none = {0, 0};
+	std::fill(table, table + 256, none);
+}
+
+/**
+ * Packs the codes of a Huffman coding into a table indexed by character.
+ * @param Codes Huffman coding of characters.
+ */
+Encoder::Encoder(const HuffCodeMap& Codes) : nCodes(0)
+{
+	Codeword none = {0, 0};
+	std::fill(table, table + 256, none);
+
+	for (HuffCodeMap::left_const_iterator it = Codes.left.begin(); it != Codes.left.end(); it++)
+	{
+		if (it->second.size() > Encoder::MaxCodeBits)
+			throw std::runtime_error("[Encoder] Code exceeds the maximum length");
+
+		Codeword& codeword = table[(unsigned char) it->first];
+		codeword.nBits = it->second.size();
+		for (unsigned int i = 0; i < codeword.nBits; i++)
+			codeword.code = (codeword.code << 1) | it->second[i];
+
+		nCodes++;
+	}
+}
+
+/**
+ * Packs the canonical codes of given code lengths into a table indexed by character.
+ * @param Lengths Code lengths of characters.
+ */
+Encoder::Encoder(const CodeLengthMap& Lengths) : nCodes(0)
+{
+	Codeword none = {0, 0};
+	std::fill(table, table + 256, none);
+
+	vector<CanonicalCode> canonical = AssignCanonicalCodes(Lengths);
+	for (vector<CanonicalCode>::const_iterator it = canonical.begin(); it != canonical.end(); it++)
+	{
+		if (it->nBits > Encoder::MaxCodeBits)
+			throw std::runtime_error("[Encoder] Code exceeds the maximum length");
+
+		Codeword codeword = {(uint32_t) it->code, (uint8_t) it->nBits};
+		table[it->symbol] = codeword;
+		nCodes++;
+	}
+}
+
+/**
+ * Adds a codeword to an accumulator and passes the accumulator on once it
+ * holds a full word.
+ * @param codeword Codeword to be added.
+ * @param acc Accumulator holding the pending bits, right-aligned.
+ * @param nAcc Number of pending bits.
+ * @param sink Function taking a word and its number of bits, right-aligned.
+ */
+template<typename Sink>
+inline void Encoder::Put(const Codeword& codeword, uint64_t& acc, unsigned int& nAcc, Sink& sink)
+{
+	if (codeword.nBits == 0)
+		throw std::out_of_range("[Encoder] Character has no code");
+
+	if (nAcc + codeword.nBits < 64)
+	{
+		acc = (acc << codeword.nBits) | codeword.code;
+		nAcc += codeword.nBits;
+	}
+	else
+	{
+		/* Codewords are at most 32 bits, so at least half a word is pending */
+		unsigned int nFirst = 64 - nAcc;
+		unsigned int nRest = codeword.nBits - nFirst;
+
+		sink((acc << nFirst) | (codeword.code >> nRest), 64);
+
+		acc = codeword.code & ((1ULL << nRest) - 1);
+		nAcc = nRest;
+	}
+}
+
+/**
+ * Emits the codes of the characters followed by the end-of-file character,
+ * collecting them in an accumulator that is passed on one word at a time.
+ * @param Symbols To be encoded characters.
+ * @param sink Function taking a word and its number of bits, right-aligned.
+ */
+template<typename Sink>
+void Encoder::Emit(const Data& Symbols, Sink& sink) const
+{
+	uint64_t acc = 0;
+	unsigned int nAcc = 0;
+
+	for (size_t i = 0; i <= Symbols.size(); i++)
+	{
+		const unsigned char ch = (i < Symbols.size()) ? Symbols[i] : (unsigned char) EoF;
+		Put(table[ch], acc, nAcc, sink);
+	}
+
+	if (nAcc > 0)
+		sink(acc, nAcc);
+}
+
+/* Passes words on to a binary vector */
+struct BitBufferSink
+{
+	DataBits& bits;
+
+	void operator()(uint64_t value, unsigned int nBits) { bits.Append(value, nBits); }
+};
+
+/* Passes words on to a vector of left-aligned words */
+struct WordSink
+{
+	vector<BitView::Word>& words;
+	size_t nBits;
+
+	void operator()(uint64_t value, unsigned int nBits)
 	{
-		compData.insert(compData.end(), Codes.left.at(*it).begin(), Codes.left.at(*it).end());
+		words.push_back(value << (BitView::WordBits - nBits));
+		this->nBits += nBits;
 	}
+};
+
+/**
+ * Encodes characters followed by the end-of-file character.
+ * @param Symbols To be encoded characters.
+ * @result Binary vector of the codes.
+ */
+DataBits Encoder::Encode(const Data& Symbols) const
+{
+	DataBits bits;
+	BitBufferSink sink = {bits};
+
+	Emit(Symbols, sink);
+
+	return bits;
+}
+
+/**
+ * Encodes characters followed by the end-of-file character into packed
+ * words, most significant bit first, as read by a BitView.
+ * @param Symbols To be encoded characters.
+ * @param words Vector to which the words are appended.
+ * @result Number of bits written.
+ */
+size_t Encoder::Encode(const Data& Symbols, vector<BitView::Word>& words) const
+{
+	WordSink sink = {words, 0};
+
+	Emit(Symbols, sink);
+
+	return sink.nBits;
+}
+
+/**
+ * Creates an encoder that appends the codes of text passed in pieces.
+ * @param Codes Encoder of the Huffman coding.
+ * @param bits Binary vector to which the codes are appended.
+ */
+StreamEncoder::StreamEncoder(const Encoder& Codes, DataBits& bits) :
+		codes(Codes), bits(bits), acc(0), nAcc(0), bFinished(false)
+{
+}
+
+/**
+ * Encodes the next piece of text. Pending bits of less than a word are
+ * kept until the following piece or the end of the text.
+ * @param pText To be encoded characters.
+ * @param nChars Number of characters.
+ */
+void StreamEncoder::Write(const char* pText, size_t nChars)
+{
+	if (bFinished)
+		throw std::runtime_error("[StreamEncoder] Text has already been finished");
 
-	compData.insert(compData.end(), Codes.left.at((char)EoF).begin(), Codes.left.at((char)EoF).end());
+	BitBufferSink sink = {bits};
 
-	return compData;
+	for (size_t i = 0; i < nChars; i++)
+		Encoder::Put(codes.table[(unsigned char) pText[i]], acc, nAcc, sink);
+}
+
+/** Encodes the end-of-file character and appends the pending bits. */
+void StreamEncoder::Finish()
+{
+	if (bFinished)
+		return;
+
+	BitBufferSink sink = {bits};
+
+	Encoder::Put(codes.table[(unsigned char) EoF], acc, nAcc, sink);
+	if (nAcc > 0)
+		sink(acc, nAcc);
+
+	bFinished = true;
 }
 
 /**
@@ -229,23 +755,179 @@ DataBits Compress(const Data& Data, const HuffCodeMap& Codes)
  */
 Data Decompress(const DataBits& Bits, const HuffCodeMap& Codes)
 {
-	Data decompData;
+	return Decoder(Codes).Decode(Bits);
+}
+
+/**
+ * Decompresses a binary vector with a prebuilt decoder, which avoids
+ * building the decoding tables for every message.
+ * @param Bits To be decompressed data.
+ * @param Codes Decoder of the Huffman coding.
+ * @result Decompressed vector of characters.
+ */
+Data Decompress(const DataBits& Bits, const Decoder& Codes)
+{
+	return Codes.Decode(Bits);
+}
+
+/** Creates a decoder without any codes. */
+Decoder::Decoder() : nPrimaryBits(0)
+{
+}
+
+/**
+ * Builds the decoding tables of a Huffman coding. The primary table is
+ * indexed by the leading bits of a code, and codes longer than that
+ * continue in secondary tables indexed by the following bits.
+ * @param Codes Huffman coding of characters.
+ */
+Decoder::Decoder(const HuffCodeMap& Codes) : nPrimaryBits(0)
+{
+	vector<Code> codes;
+
+	for (HuffCodeMap::left_const_iterator it = Codes.left.begin(); it != Codes.left.end(); it++)
+	{
+		if (it->second.empty())
+			continue;
+
+		if (it->second.size() > MaxDecodeBits)
+			throw std::runtime_error("[Decoder] Code exceeds the maximum length");
+
+		Code code = {0, (unsigned int) it->second.size(), (unsigned char) it->first};
+		for (unsigned int i = 0; i < code.nBits; i++)
+			code.bits |= (uint64_t) it->second[i] << (MaxDecodeBits - 1 - i);
+
+		codes.push_back(code);
+	}
+
+	Build(codes);
+}
+
+/**
+ * Builds the decoding tables of the canonical Huffman coding of given code lengths.
+ * @param Lengths Code lengths of characters.
+ */
+Decoder::Decoder(const CodeLengthMap& Lengths) : nPrimaryBits(0)
+{
+	vector<CanonicalCode> canonical = AssignCanonicalCodes(Lengths);
+	vector<Code> codes;
+
+	for (vector<CanonicalCode>::const_iterator it = canonical.begin(); it != canonical.end(); it++)
+	{
+		Code code = {it->code << (MaxDecodeBits - it->nBits), it->nBits, it->symbol};
+		codes.push_back(code);
+	}
+
+	Build(codes);
+}
 
-	DataBits ch;
-	for (DataBits::const_iterator it = Bits.begin(); it != Bits.end(); it++)
+/**
+ * Builds the primary table and the secondary tables behind it.
+ * @param Codes Codes of the characters, left-aligned.
+ */
+void Decoder::Build(const vector<Code>& Codes)
+{
+	unsigned int nMaxBits = 0;
+	for (vector<Code>::const_iterator it = Codes.begin(); it != Codes.end(); it++)
+		nMaxBits = std::max(nMaxBits, it->nBits);
+
+	if (Codes.empty())
+		return;
+
+	nPrimaryBits = std::min(nMaxBits, PrimaryBits);
+	BuildTable(Codes, 0, nPrimaryBits);
+}
+
+/**
+ * Appends a decoding table for codes sharing their first \p nConsumed bits.
+ * @param Codes Codes with the common prefix, left-aligned.
+ * @param nConsumed Length of the common prefix.
+ * @param nTableBits Index width of the table.
+ * @result Offset of the table.
+ */
+size_t Decoder::BuildTable(const vector<Code>& Codes, unsigned int nConsumed, unsigned int nTableBits)
+{
+	const size_t Offset = table.size();
+	const unsigned int Shift = MaxDecodeBits - nTableBits;
+
+	Entry invalid = {0, 0, Entry::INVALID};
+	table.resize(Offset + ((size_t) 1 << nTableBits), invalid);
+
+	/* Codes continuing behind this table, grouped by their index */
+	map<size_t, vector<Code> > links;
+
+	for (vector<Code>::const_iterator it = Codes.begin(); it != Codes.end(); it++)
 	{
-		ch.push_back(*it);
+		size_t idx = (it->bits << nConsumed) >> Shift;
 
-		HuffCodeMap::right_const_iterator it2 = Codes.right.find(ch);
-		if (it2 != Codes.right.end())
+		if (it->nBits <= nConsumed + nTableBits)
 		{
-			unsigned char tmp = it2->second;
-			if (tmp == EoF)
-				break;
+			/* Short codes fill every entry that starts with them */
+			size_t nFill = (size_t) 1 << (nConsumed + nTableBits - it->nBits);
+			Entry entry = {it->symbol, (uint8_t) it->nBits, Entry::SYMBOL};
+
+			std::fill(table.begin() + Offset + idx, table.begin() + Offset + idx + nFill, entry);
+		}
+		else
+		{
+			links[idx].push_back(*it);
+		}
+	}
+
+	for (map<size_t, vector<Code> >::const_iterator it = links.begin(); it != links.end(); it++)
+	{
+		unsigned int nMaxBits = 0;
+		for (vector<Code>::const_iterator it2 = it->second.begin(); it2 != it->second.end(); it2++)
+			nMaxBits = std::max(nMaxBits, it2->nBits);
+
+		unsigned int nSubBits = std::min(nMaxBits - nConsumed - nTableBits, SecondaryBits);
+		size_t subOffset = BuildTable(it->second, nConsumed + nTableBits, nSubBits);
+
+		Entry entry = {(uint32_t) subOffset, (uint8_t) nSubBits, Entry::LINK};
+		table[Offset + it->first] = entry;
+	}
+
+	return Offset;
+}
+
+/**
+ * Decodes characters until the end-of-file character, an invalid code or
+ * the end of the binary vector.
+ * @param Bits To be decoded data.
+ * @result Decoded vector of characters.
+ */
+Data Decoder::Decode(const BitView& Bits) const
+{
+	Data decompData;
+
+	if (empty())
+		return decompData;
+
+	size_t pos = 0;
+	while (pos < Bits.size())
+	{
+		uint64_t window = Bits.Peek(pos, MaxDecodeBits);
+
+		const Entry* entry = &table[window >> (MaxDecodeBits - nPrimaryBits)];
+		unsigned int nConsumed = nPrimaryBits;
 
-			decompData.push_back(tmp);
-			ch.clear();
+		while (entry->type == Entry::LINK)
+		{
+			unsigned int nSubBits = entry->nBits;
+			entry = &table[entry->value + ((window << nConsumed) >> (MaxDecodeBits - nSubBits))];
+			nConsumed += nSubBits;
 		}
+
+		if (entry->type == Entry::INVALID || pos + entry->nBits > Bits.size())
+			break;
+
+		pos += entry->nBits;
+
+		unsigned char tmp = entry->value;
+		if (tmp == EoF)
+			break;
+
+		decompData.push_back(tmp);
 	}
 
 	return decompData;
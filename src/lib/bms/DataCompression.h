@@ -16,23 +16,144 @@ const char EoF = (char)0x03;
 
 #include "Types.h"
 
+#include <array>
 #include <vector>
 #include <map>
 #include <string>
 #include <boost/bimap.hpp>
 
 typedef std::map<char,int> FreqMap;
+typedef std::map<char, FreqMap> ContextFreqMap;
+typedef std::array<uint64_t, 256> Histogram;
 typedef std::vector<bool> HuffCode;
 typedef boost::bimap<char, HuffCode> HuffCodeMap;
+typedef std::map<char, unsigned int> CodeLengthMap;
 
 namespace HuffmanCoding
 {
+	class Decoder
+	{
+	public:
+		/* === Constructors === */
+		Decoder();
+		explicit Decoder(const HuffCodeMap& Codes);
+		explicit Decoder(const CodeLengthMap& Lengths);
+
+		/* === Capacity === */
+		bool empty() const { return table.empty(); }
+
+		/* === Decoding === */
+		Data Decode(const BitView& Bits) const;
+
+	private:
+		/* Table entry holding a symbol or a link to a secondary table */
+		struct Entry
+		{
+			enum Type : uint8_t {INVALID, SYMBOL, LINK};
+
+			uint32_t value;
+			uint8_t nBits;
+			Type type;
+		};
+
+		struct Code
+		{
+			uint64_t bits;
+			unsigned int nBits;
+			unsigned char symbol;
+		};
+
+		std::vector<Entry> table;
+		unsigned int nPrimaryBits;
+
+		void Build(const std::vector<Code>& Codes);
+		size_t BuildTable(const std::vector<Code>& Codes, unsigned int nConsumed, unsigned int nTableBits);
+	};
+
+	class Encoder
+	{
+	public:
+		/* Longest code the encoding table can hold */
+		static const unsigned int MaxCodeBits = 32;
+
+		/* === Constructors === */
+		Encoder();
+		explicit Encoder(const HuffCodeMap& Codes);
+		explicit Encoder(const CodeLengthMap& Lengths);
+
+		/* === Capacity === */
+		bool empty() const { return nCodes == 0; }
+
+		/* === Lookup === */
+		unsigned int Length(char symbol) const { return table[(unsigned char) symbol].nBits; }
+
+		/* === Encoding === */
+		DataBits Encode(const Data& Symbols) const;
+		size_t Encode(const Data& Symbols, std::vector<BitView::Word>& words) const;
+
+	private:
+		/* Codeword right-aligned in the lower bits */
+		struct Codeword
+		{
+			uint32_t code;
+			uint8_t nBits;
+		};
+
+		Codeword table[256];
+		size_t nCodes;
+
+		friend class StreamEncoder;
+
+		template<typename Sink>
+		static void Put(const Codeword& codeword, uint64_t& acc, unsigned int& nAcc, Sink& sink);
+
+		template<typename Sink>
+		void Emit(const Data& Symbols, Sink& sink) const;
+	};
+
+	class StreamEncoder
+	{
+	public:
+		/* === Constructors === */
+		StreamEncoder(const Encoder& Codes, DataBits& bits);
+
+		/* === Encoding === */
+		void Write(const char* pText, size_t nChars);
+		void Finish();
+
+	private:
+		const Encoder& codes;
+		DataBits& bits;
+		uint64_t acc;
+		unsigned int nAcc;
+		bool bFinished;
+	};
+
+	bool IsCharInvalid(const char symbol);
+	size_t FilterCharDomain(char* pText, size_t nChars);
 	void TransformCharDomain(std::string& text);
+
+	/* Code compiled in from config/huffcode.map, built on first use */
+	const HuffCodeMap& DefaultCode();
+	const Encoder& DefaultEncoder();
+	const Decoder& DefaultDecoder();
+
 	FreqMap ComputeFrequencies(const std::string& Text);
+	FreqMap ComputeFrequencies(const Histogram& Counts);
+	void AccumulateHistogram(Histogram& counts, const char* pText, size_t nChars);
+	ContextFreqMap ComputeContextFrequencies(const std::string& Text);
 	HuffCodeMap GenerateCodes(const FreqMap& Frequencies);
 
+	CodeLengthMap ComputeCodeLengths(const FreqMap& Frequencies, unsigned int nMaxBits = 0);
+	CodeLengthMap GetCodeLengths(const HuffCodeMap& Codes);
+	void LimitCodeLengths(CodeLengthMap& lengths, unsigned int nMaxBits);
+	HuffCodeMap GenerateCanonicalCodes(const CodeLengthMap& Lengths);
+	bool IsCanonical(const HuffCodeMap& Codes);
+
 	DataBits Compress(const Data& Data, const HuffCodeMap& Codes);
+	DataBits Compress(const Data& Data, const Encoder& Codes);
 	Data Decompress(const DataBits& Data, const HuffCodeMap& Codes);
+	Data Decompress(const DataBits& Data, const Decoder& Codes);
 };
 
 #endif
@@ -11,10 +11,18 @@
  */
 
 #include "DataInterface.h"
+#include "BitKernels.h"
 #include "Maths.h"
+#include "Random.h"
+#include "Secp256k1.h"
+#include "ThreadPool.h"
 #include "Utilities.h"
 
+#include <cmath>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <string.h>
 
 using std::vector;
 namespace mp = boost::multiprecision;
@@ -22,41 +30,170 @@ namespace mp = boost::multiprecision;
 namespace DataInterface
 {
 
+/* Number of random suffixes checked per batch when encoding public keys */
+static const size_t PubkeyBatchSize = 8;
+
+/* Maximum number of memoized composition capacities */
+static const size_t CapacityCacheSize = 1 << 12;
+
+/* Margin covering the rounding errors of the capacity estimates */
+static const double EstimateMargin = 1e-6;
+
+static std::mutex CapacityLock;
+static std::map<std::pair<uint64_t, uint16_t>, uint32_t> ValuesCapacity;
+static vector<uint32_t> PermutationCapacity;
+
+/**
+ * Converts a binary vector into an integer of a fixed-width backend.
+ * @param Bits A binary vector no longer than the backend.
+ * @result Converted integer.
+ */
+template<typename Int>
+static Int BitsToInteger(const BitView& Bits)
+{
+	const unsigned int Lead = Bits.size() % 32;
+
+	Int num = Int(Bits.Peek(0, Lead));
+	for (size_t pos = Lead; pos < Bits.size(); pos += 32)
+	{
+		num <<= 32;
+		num |= Int(Bits.Peek(pos, 32));
+	}
+
+	return num;
+}
+
+/**
+ * Appends an integer of a fixed-width backend as a binary vector of \p nBits bits.
+ * @param num Integer to be converted.
+ * @param nBits Number of bits, including leading zero's.
+ * @param Bits Binary vector to which the bits are appended.
+ */
+template<typename Int>
+static void AppendInteger(const Int& num, uint32_t nBits, DataBits& Bits)
+{
+	const uint32_t Lead = nBits % 32;
+
+	if (Lead != 0)
+		Bits.Append(static_cast<uint64_t>(Int(num >> (nBits - Lead))), Lead);
+
+	for (uint32_t shift = nBits - Lead; shift > 0; shift -= 32)
+		Bits.Append(static_cast<uint64_t>(Int((num >> (shift - 32)) & Int(0xFFFFFFFF))), 32);
+}
+
+/**
+ * Computes the number of bits an integer backend needs to rank compositions,
+ * covering the largest count and the factors of its binomial coefficients.
+ * @param MaxBits Number of bits embeddable in the composition.
+ * @param n Integer of the combinatorial composition.
+ * @param k Number of parts.
+ * @result Number of bits.
+ */
+static uint32_t ValuesBackendBits(uint32_t MaxBits, uint64_t n, uint16_t k)
+{
+	uint32_t nFactorBits = 0;
+	for (uint64_t x = n + k; x != 0; x >>= 1)
+		nFactorBits++;
+
+	return MaxBits + 1 + nFactorBits + 1;
+}
+
+/**
+ * Computes the number of bits an integer backend needs to rank permutations.
+ * @param MaxBits Number of bits embeddable in the permutation.
+ * @result Number of bits.
+ */
+static uint32_t PermutationBackendBits(uint32_t MaxBits)
+{
+	return MaxBits + 1 + 16 + 1;
+}
+
+/* Block of consecutive factorial number system digits packed into one word */
+struct RadixBlock
+{
+	uint16_t nFirst;
+	uint16_t nLast;
+	uint32_t nBits;
+};
+
+/**
+ * Splits the digits of the factorial number system for \p nParts elements into
+ * blocks, starting with the largest radix, whose radix products fit into a word.
+ * Each block embeds the floor of the binary logarithm of its radix product.
+ * @param nParts Number of elements in the permutation.
+ * @result The blocks in order of their digits.
+ */
+static vector<RadixBlock> RadixBlocks(uint16_t nParts)
+{
+	vector<RadixBlock> blocks;
+	uint64_t product = 1;
+	uint16_t nFirst = 0;
+
+	/* Digit i has radix nParts-i, the last digit is always zero */
+	for (uint16_t i = 0; i + 1 < nParts; i++)
+	{
+		const uint64_t Radix = nParts - i;
+
+		if (product > UINT64_MAX / Radix)
+		{
+			blocks.push_back({nFirst, i, (uint32_t) mp::msb(product)});
+			nFirst = i;
+			product = 1;
+		}
+
+		product *= Radix;
+	}
+
+	if (product > 1)
+		blocks.push_back({nFirst, (uint16_t) (nParts - 1), (uint32_t) mp::msb(product)});
+
+	return blocks;
+}
+
+template<typename Int>
+static vector<uint64_t> EncodeValues(const BitView& Data, uint64_t budget, uint16_t nParts)
+{
+	return Math::Combinatorics<Int>::IntegerToComposition(BitsToInteger<Int>(Data), budget, nParts);
+}
+
+template<typename Int>
+static void DecodeValues(const vector<uint64_t>& Values, uint32_t MaxBits, DataBits& Bits)
+{
+	AppendInteger(Math::Combinatorics<Int>::CompositionToInteger(Values), MaxBits, Bits);
+}
+
+template<typename Int>
+static vector<uint16_t> EncodePermutation(const BitView& Data, uint16_t nParts)
+{
+	return Math::Combinatorics<Int>::IntegerToPermutation(BitsToInteger<Int>(Data), nParts);
+}
+
+template<typename Int>
+static void DecodePermutation(const vector<uint16_t>& Permutation, uint32_t MaxBits, DataBits& Bits)
+{
+	AppendInteger(Math::Combinatorics<Int>::PermutationToInteger(Permutation), MaxBits, Bits);
+}
+
 /**
  * Converts a binary vector into an unsigned integer.
  * @param Bits A binary vector.
  * @result An unsigned integer representing the binary vector.
  */
-unsigned int EncodeDataInSequenceNr(const DataBits& Bits)
+unsigned int EncodeDataInSequenceNr(const BitView& Bits)
 {
 	assert(Bits.size() == 32);
 
-	Data data = BitsToData(Bits);
-	uint seqnr = 0;
-
-	seqnr |= data[0] << 24;
-	seqnr |= data[1] << 16;
-	seqnr |= data[2] << 8;
-	seqnr |= data[3];
-
-	return seqnr;
+	return Bits.Peek(0, 32);
 }
 
 /**
  * Converts an unsigned integer into a binary vector.
  * @param sequenceNr An unsigned integer.
- * @result A binary vector representing the unsigned integer.
+ * @param Bits Binary vector to which the bits representing the unsigned integer are appended.
  */
-DataBits DecodeDataInSequenceNr(unsigned int sequenceNr)
+void DecodeDataInSequenceNr(unsigned int sequenceNr, DataBits& Bits)
 {
-	Data tmp;
-
-	tmp.push_back((sequenceNr >> 24) & 0xFF);
-	tmp.push_back((sequenceNr >> 16) & 0xFF);
-	tmp.push_back((sequenceNr >> 8) & 0xFF);
-	tmp.push_back(sequenceNr & 0xFF);
-
-	return DataToBits(tmp);
+	Bits.Append(sequenceNr, 32);
 }
 
 /**
@@ -65,54 +202,79 @@ DataBits DecodeDataInSequenceNr(unsigned int sequenceNr)
  * @param nRandBits Number of random bits.
  * @result Public key representing the binary vector.
  */
-CPubKey EncodeDataInPubkey(const DataBits& Data, uint8_t nRandBits)
+CPubKey EncodeDataInPubkey(const BitView& Data, uint8_t nRandBits)
 {
 	assert(1 <= Data.size());
 	assert(5 <= nRandBits);
 	assert(255 - Data.size() == nRandBits);
 
-	CPubKey pk;
-	DataBits prefix;
-	DataBits data;
-	DataBits random;
+	BitSpan::Word buf[5] = {0};
+	BitSpan key(buf, 264);
+	unsigned char vch[33];
+	unsigned char xs[PubkeyBatchSize][Secp256k1::CoordinateSize];
 
-	prefix.insert(prefix.end(), 6, false);
-	prefix.insert(prefix.end(), true);
-	prefix.insert(prefix.end(), false);
+	/* Even y-coordinate prefix followed by a cleared most significant bit */
+	key.Write(0, 0x02, 8);
+	key.Write(9, Data);
 
-	data.insert(data.end(), false);
-	data.insert(data.end(), Data.begin(), Data.end());
-	data.insert(data.end(), 256 - data.size() - nRandBits, false);
+	Random::BitReader random;
 
-	do
+	while (true)
 	{
-		random = Utilities::GenerateRandomBits(nRandBits);
+		for (size_t i = 0; i < PubkeyBatchSize; i++)
+		{
+			for (unsigned int pos = 264 - nRandBits; pos < 264; pos += 64)
+			{
+				unsigned int nBits = std::min(264 - pos, 64u);
+				key.Write(pos, random.Read(nBits), nBits);
+			}
+			BitView(key).CopyBytes(vch);
+
+			memcpy(xs[i], vch + 1, Secp256k1::CoordinateSize);
+		}
+
+		size_t idx = Secp256k1::FindValidX(xs[0], PubkeyBatchSize);
+		if (idx < PubkeyBatchSize)
+		{
+			memcpy(vch + 1, xs[idx], Secp256k1::CoordinateSize);
+			return CPubKey(vch, vch + 33);
+		}
+	}
+}
 
-		DataBits tmp;
-		tmp.insert(tmp.end(), prefix.begin(), prefix.end());
-		tmp.insert(tmp.end(), data.begin(), data.end());
-		tmp.insert(tmp.end(), random.begin(), random.end());
+/**
+ * Converts binary vectors into public keys, spreading the search for
+ * valid keys over the threads of the shared thread pool.
+ * @param Data Binary vectors, each of 255 - \p nRandBits bits.
+ * @param nRandBits Number of random suffix bits.
+ * @result Public keys in the order of the binary vectors.
+ */
+vector<CPubKey> EncodeDataInPubkeys(const vector<DataBits>& Data, uint8_t nRandBits)
+{
+	vector<CPubKey> pubkeys(Data.size());
 
-		pk = CPubKey(BitsToData(tmp));
-	} while (!pk.IsFullyValid());
+	ThreadPool::Default().Run(Data.size(), [&](size_t i)
+	{
+		pubkeys[i] = EncodeDataInPubkey(Data[i], nRandBits);
+	});
 
-	return pk;
+	return pubkeys;
 }
 
 /**
  * Converts a public key into a binary vector.
- * @param Bits A public key.
+ * @param Pubkey A public key.
  * @param nRandBits Number of random bits.
- * @result Binary vector representing the public key.
+ * @param Bits Binary vector to which the bits represented by the public key are appended.
  */
-DataBits DecodeDataInPubkey(const CPubKey& Pubkey, uint8_t nRandBits)
+void DecodeDataInPubkey(const CPubKey& Pubkey, uint8_t nRandBits, DataBits& Bits)
 {
-	DataBits buf = DataToBits(Data(Pubkey.begin(), Pubkey.end()));
+	assert(Pubkey.size() == 33);
 
-	buf.erase(buf.begin(), buf.begin() + 9);
-	buf.erase(buf.end() - nRandBits, buf.end());
+	BitView::Word buf[5];
+	BitKernels::PackBytes(Pubkey.begin(), Pubkey.size(), buf);
 
-	return buf;
+	Bits.Append(BitView(buf, 5, 0, 264).Sub(9, 255 - nRandBits));
 }
 
 /**
@@ -123,11 +285,43 @@ DataBits DecodeDataInPubkey(const CPubKey& Pubkey, uint8_t nRandBits)
  */
 uint32_t EmbeddableBitsInValues(uint64_t n, uint16_t k)
 {
-	BigFloat result;
-	result = mp::log(BigFloat(Math::NumberCompositions(n, k)));
-	result /= mp::log(BigFloat(2));
+	const std::pair<uint64_t, uint16_t> key(n, k);
+	{
+		std::lock_guard<std::mutex> guard(CapacityLock);
+
+		auto it = ValuesCapacity.find(key);
+		if (it != ValuesCapacity.end())
+			return it->second;
+	}
 
-	return (uint32_t) result;
+	uint32_t result = mp::msb(Math::NumberCompositions(n, k));
+
+	{
+		std::lock_guard<std::mutex> guard(CapacityLock);
+
+		if (ValuesCapacity.size() >= CapacityCacheSize)
+			ValuesCapacity.clear();
+		ValuesCapacity[key] = result;
+	}
+
+	return result;
+}
+
+/**
+ * Estimates an upper bound on the number of bits that can be embedded in a
+ * combinatorial composition, without multiple precision arithmetic.
+ * @param n Integer of the combinatorial composition.
+ * @param k Number of parts.
+ * @result Upper bound on the number of bits that can be embedded.
+ */
+uint32_t EmbeddableBitsInValuesBound(uint64_t n, uint16_t k)
+{
+	/* log2 of (n+k-1)-choose-(k-1) as a sum over its factors */
+	double result = 0;
+	for (uint16_t i = 1; i < k; i++)
+		result += std::log2(((double) n + i) / i);
+
+	return (uint32_t) (result + EstimateMargin);
 }
 
 
@@ -138,13 +332,27 @@ uint32_t EmbeddableBitsInValues(uint64_t n, uint16_t k)
  * @param nParts Number of parts.
  * @result Combinatorial composition of the budget representing the binary vector.
  */
-vector<uint64_t> EncodeDataInValues(const DataBits& Data, uint64_t budget, uint16_t nParts)
+vector<uint64_t> EncodeDataInValues(const BitView& Data, uint64_t budget, uint16_t nParts)
 {
 	const uint32_t MaxBits = EmbeddableBitsInValues(budget, nParts);
 
 	assert(Data.size() == MaxBits);
 	assert(nParts >= 2);
 
+	switch (Math::SelectBackend(ValuesBackendBits(MaxBits, budget, nParts)))
+	{
+	case Math::BACKEND_64:
+		return EncodeValues<Math::UInt64>(Data, budget, nParts);
+	case Math::BACKEND_128:
+		return EncodeValues<Math::UInt128>(Data, budget, nParts);
+	case Math::BACKEND_256:
+		return EncodeValues<Math::UInt256>(Data, budget, nParts);
+	case Math::BACKEND_512:
+		return EncodeValues<Math::UInt512>(Data, budget, nParts);
+	default:
+		break;
+	}
+
 	BigInt idx = DataBitsToInt(Data);
 	vector<uint64_t> composition = Math::IntegerToComposition(idx, budget, nParts);
 
@@ -154,9 +362,9 @@ vector<uint64_t> EncodeDataInValues(const DataBits& Data, uint64_t budget, uint1
 /**
  * Converts a combinatorial composition of the budget into a binary vector.
  * @param Values The combinatorial composition.
- * @result Binary vector representing the combinatorial composition of the budget.
+ * @param Bits Binary vector to which the bits represented by the composition are appended.
  */
-DataBits DecodeDataInValues(const vector<uint64_t>& Values)
+void DecodeDataInValues(const vector<uint64_t>& Values, DataBits& Bits)
 {
 	const uint64_t Budget = std::accumulate(Values.begin(), Values.end(), (uint64_t) 0);
 	const uint16_t nParts = Values.size();
@@ -165,12 +373,25 @@ DataBits DecodeDataInValues(const vector<uint64_t>& Values)
 
 	const uint32_t MaxBits = EmbeddableBitsInValues(Budget, nParts);
 
-	BigInt idx = Math::CompositionToInteger(Values);
+	switch (Math::SelectBackend(ValuesBackendBits(MaxBits, Budget, nParts)))
+	{
+	case Math::BACKEND_64:
+		return DecodeValues<Math::UInt64>(Values, MaxBits, Bits);
+	case Math::BACKEND_128:
+		return DecodeValues<Math::UInt128>(Values, MaxBits, Bits);
+	case Math::BACKEND_256:
+		return DecodeValues<Math::UInt256>(Values, MaxBits, Bits);
+	case Math::BACKEND_512:
+		return DecodeValues<Math::UInt512>(Values, MaxBits, Bits);
+	default:
+		break;
+	}
 
+	BigInt idx = Math::CompositionToInteger(Values);
 	DataBits data = IntToDataBits(idx);
-	data.insert(data.begin(), MaxBits - data.size(), false);
 
-	return data;
+	Bits.Pad(MaxBits - data.size());
+	Bits.Append(data);
 }
 
 /**
@@ -180,11 +401,57 @@ DataBits DecodeDataInValues(const vector<uint64_t>& Values)
  */
 uint32_t EmbeddableBitsInPermutation(uint16_t nParts)
 {
-	BigFloat result;
-	result = mp::log(BigFloat(Math::Factorial(nParts)));
-	result /= mp::log(BigFloat(2));
+	if (IsPermutationStreamed())
+		return EmbeddableBitsInPermutationBlocks(nParts);
+
+	std::lock_guard<std::mutex> guard(CapacityLock);
+
+	while (PermutationCapacity.size() <= nParts)
+		PermutationCapacity.push_back(mp::msb(Math::Factorial(PermutationCapacity.size())));
+
+	return PermutationCapacity[nParts];
+}
+
+/**
+ * Checks whether permutations are encoded block-wise in word-sized mixed radix
+ * instead of by their exact lexicographic index, as set in the configuration file.
+ * @result True if permutations are encoded block-wise. Otherwise not.
+ */
+bool IsPermutationStreamed()
+{
+	auto it = Utilities::Config.find("Permutation.Streaming");
+	return it != Utilities::Config.end() && it->second == "1";
+}
+
+/**
+ * Computes the number of bits that can be embedded in a permutation
+ * when encoding it block-wise in word-sized mixed radix.
+ * @param nParts Number of elements in the permutation.
+ * @result Number of bits that can be embedded.
+ */
+uint32_t EmbeddableBitsInPermutationBlocks(uint16_t nParts)
+{
+	uint32_t result = 0;
+
+	for (const RadixBlock& block : RadixBlocks(nParts))
+		result += block.nBits;
+
+	return result;
+}
+
+/**
+ * Estimates an upper bound on the number of bits that can be embedded in a
+ * permutation, without multiple precision arithmetic.
+ * @param nParts Number of elements in the permutation.
+ * @result Upper bound on the number of bits that can be embedded.
+ */
+uint32_t EmbeddableBitsInPermutationBound(uint16_t nParts)
+{
+	double result = 0;
+	for (uint16_t i = 2; i <= nParts; i++)
+		result += std::log2((double) i);
 
-	return (uint32_t) result;
+	return (uint32_t) (result + EstimateMargin);
 }
 
 
@@ -194,13 +461,30 @@ uint32_t EmbeddableBitsInPermutation(uint16_t nParts)
  * @param nParts Number of elements in the permutation.
  * @result Permutation representing the binary vector.
  */
-vector<uint16_t> EncodeDataInPermutation(const DataBits& Data, uint16_t nParts)
+vector<uint16_t> EncodeDataInPermutation(const BitView& Data, uint16_t nParts)
 {
+	if (IsPermutationStreamed())
+		return EncodeDataInPermutationBlocks(Data, nParts);
+
 	const uint32_t MaxBits = EmbeddableBitsInPermutation(nParts);
 
 	assert(nParts >= 2);
 	assert(Data.size() == MaxBits);
 
+	switch (Math::SelectBackend(PermutationBackendBits(MaxBits)))
+	{
+	case Math::BACKEND_64:
+		return EncodePermutation<Math::UInt64>(Data, nParts);
+	case Math::BACKEND_128:
+		return EncodePermutation<Math::UInt128>(Data, nParts);
+	case Math::BACKEND_256:
+		return EncodePermutation<Math::UInt256>(Data, nParts);
+	case Math::BACKEND_512:
+		return EncodePermutation<Math::UInt512>(Data, nParts);
+	default:
+		break;
+	}
+
 	BigInt idx = DataBitsToInt(Data);
 	vector<uint16_t> perm = Math::IntegerToPermutation(idx, nParts);
 
@@ -210,21 +494,91 @@ vector<uint16_t> EncodeDataInPermutation(const DataBits& Data, uint16_t nParts)
 /**
  * Converts a permutation into a binary vector.
  * @param Permutation The permutation.
- * @result Binary vector representing the permutation.
+ * @param Bits Binary vector to which the bits represented by the permutation are appended.
  */
-DataBits DecodeDataInPermutation(const vector<uint16_t>& Permutation)
+void DecodeDataInPermutation(const vector<uint16_t>& Permutation, DataBits& Bits)
 {
+	if (IsPermutationStreamed())
+		return DecodeDataInPermutationBlocks(Permutation, Bits);
+
 	const uint16_t Size = Permutation.size();
 	const uint32_t MaxBits = EmbeddableBitsInPermutation(Size);
 
 	assert(Size >= 2);
 
+	switch (Math::SelectBackend(PermutationBackendBits(MaxBits)))
+	{
+	case Math::BACKEND_64:
+		return DecodePermutation<Math::UInt64>(Permutation, MaxBits, Bits);
+	case Math::BACKEND_128:
+		return DecodePermutation<Math::UInt128>(Permutation, MaxBits, Bits);
+	case Math::BACKEND_256:
+		return DecodePermutation<Math::UInt256>(Permutation, MaxBits, Bits);
+	case Math::BACKEND_512:
+		return DecodePermutation<Math::UInt512>(Permutation, MaxBits, Bits);
+	default:
+		break;
+	}
+
 	BigInt idx = Math::PermutationToInteger(Permutation);
 	DataBits data = IntToDataBits(idx);
 
-	data.insert(data.begin(), MaxBits - data.size(), false);
+	Bits.Pad(MaxBits - data.size());
+	Bits.Append(data);
+}
+
+/**
+ * Converts a binary vector into a permutation with a specified number of elements,
+ * reading the digits of the factorial number system block-wise from the bits.
+ * @param Data A binary vector.
+ * @param nParts Number of elements in the permutation.
+ * @result Permutation representing the binary vector.
+ */
+vector<uint16_t> EncodeDataInPermutationBlocks(const BitView& Data, uint16_t nParts)
+{
+	assert(nParts >= 2);
+	assert(Data.size() == EmbeddableBitsInPermutationBlocks(nParts));
+
+	vector<uint16_t> digits(nParts, 0);
+	size_t pos = 0;
+
+	for (const RadixBlock& block : RadixBlocks(nParts))
+	{
+		uint64_t value = Data.Peek(pos, block.nBits);
+		pos += block.nBits;
+
+		for (int i = block.nLast - 1; i >= block.nFirst; i--)
+		{
+			digits[i] = value % (nParts - i);
+			value /= (nParts - i);
+		}
+	}
+
+	return Math::DigitsToPermutation(digits);
+}
+
+/**
+ * Converts a permutation into a binary vector, writing the digits of the
+ * factorial number system block-wise into the bits.
+ * @param Permutation The permutation.
+ * @param Bits Binary vector to which the bits represented by the permutation are appended.
+ */
+void DecodeDataInPermutationBlocks(const vector<uint16_t>& Permutation, DataBits& Bits)
+{
+	const uint16_t Size = Permutation.size();
+
+	assert(Size >= 2);
+
+	const vector<uint16_t> digits = Math::PermutationToDigits(Permutation);
+
+	for (const RadixBlock& block : RadixBlocks(Size))
+	{
+		uint64_t value = 0;
+		for (uint16_t i = block.nFirst; i < block.nLast; i++)
+			value = value * (Size - i) + digits[i];
 
-	return data;
+		Bits.Append(value, block.nBits);
+	}
 }
 
 }
@@ -17,19 +17,27 @@
 
 namespace DataInterface
 {
-	unsigned int EncodeDataInSequenceNr(const DataBits& Data);
-	DataBits DecodeDataInSequenceNr(unsigned int sequenceNr);
+	unsigned int EncodeDataInSequenceNr(const BitView& Data);
+	void DecodeDataInSequenceNr(unsigned int sequenceNr, DataBits& Bits);
 
-	CPubKey EncodeDataInPubkey(const DataBits& Data, uint8_t nRandBits);
-	DataBits DecodeDataInPubkey(const CPubKey& Pubkey, uint8_t nRandBits);
+	CPubKey EncodeDataInPubkey(const BitView& Data, uint8_t nRandBits);
+	std::vector<CPubKey> EncodeDataInPubkeys(const std::vector<DataBits>& Data, uint8_t nRandBits);
+	void DecodeDataInPubkey(const CPubKey& Pubkey, uint8_t nRandBits, DataBits& Bits);
 
 	uint32_t EmbeddableBitsInValues(uint64_t n, uint16_t k);
-	std::vector<uint64_t> EncodeDataInValues(const DataBits& Data, uint64_t budget, uint16_t nParts);
-	DataBits DecodeDataInValues(const std::vector<uint64_t>& Values);
+	uint32_t EmbeddableBitsInValuesBound(uint64_t n, uint16_t k);
+	std::vector<uint64_t> EncodeDataInValues(const BitView& Data, uint64_t budget, uint16_t nParts);
+	void DecodeDataInValues(const std::vector<uint64_t>& Values, DataBits& Bits);
 
 	uint32_t EmbeddableBitsInPermutation(uint16_t nParts);
-	std::vector<uint16_t> EncodeDataInPermutation(const DataBits& Data, uint16_t nParts);
-	DataBits DecodeDataInPermutation(const std::vector<uint16_t>& Permutation);
+	uint32_t EmbeddableBitsInPermutationBound(uint16_t nParts);
+	std::vector<uint16_t> EncodeDataInPermutation(const BitView& Data, uint16_t nParts);
+	void DecodeDataInPermutation(const std::vector<uint16_t>& Permutation, DataBits& Bits);
+
+	bool IsPermutationStreamed();
+	uint32_t EmbeddableBitsInPermutationBlocks(uint16_t nParts);
+	std::vector<uint16_t> EncodeDataInPermutationBlocks(const BitView& Data, uint16_t nParts);
+	void DecodeDataInPermutationBlocks(const std::vector<uint16_t>& Permutation, DataBits& Bits);
 };
 
 #endif
@@ -0,0 +1,83 @@
+/**
+ * DefaultCode.cpp
+ *
+ * Huffman code compiled into the library. The table is generated
+ * from config/huffcode.map at build time, and its mapping as well
+ * as its encoding and decoding tables are built on first use, so
+ * that no code file needs to be parsed and binaries using another
+ * code do not build them at all.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "DataCompression.h"
+
+namespace HuffmanCoding
+{
+
+/* Code of a character, right-aligned in the lower bits */
+struct StaticCode
+{
+	unsigned char symbol;
+	unsigned int nBits;
+	uint64_t code;
+};
+
+static constexpr StaticCode DefaultCodes[] = {
+#include "DefaultCode.inc"
+};
+
+/**
+ * Builds the mapping of the compiled-in code.
+ * @result Huffman coding of characters.
+ */
+static HuffCodeMap BuildDefaultCode()
+{
+	HuffCodeMap codes;
+
+	for (size_t i = 0; i < sizeof(DefaultCodes) / sizeof(DefaultCodes[0]); i++)
+	{
+		const StaticCode& entry = DefaultCodes[i];
+
+		HuffCode code(entry.nBits);
+		for (unsigned int j = 0; j < entry.nBits; j++)
+			code[j] = (entry.code >> (entry.nBits - 1 - j)) & 1;
+
+		codes.insert(HuffCodeMap::value_type((char) entry.symbol, code));
+	}
+
+	return codes;
+}
+
+/**
+ * Returns the mapping of the compiled-in code, built on first use.
+ * @result Huffman coding of characters.
+ */
+const HuffCodeMap& DefaultCode()
+{
+	static const HuffCodeMap codes = BuildDefaultCode();
+	return codes;
+}
+
+/**
+ * Returns the encoder of the compiled-in code, built on first use.
+ * @result Encoder of the Huffman coding.
+ */
+const Encoder& DefaultEncoder()
+{
+	static const Encoder encoder(DefaultCode());
+	return encoder;
+}
+
+/**
+ * Returns the decoder of the compiled-in code, built on first use.
+ * @result Decoder of the Huffman coding.
+ */
+const Decoder& DefaultDecoder()
+{
+	static const Decoder decoder(DefaultCode());
+	return decoder;
+}
+
+}
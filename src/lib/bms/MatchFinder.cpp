@@ -0,0 +1,198 @@
+/**
+ * MatchFinder.cpp
+ *
+ * LZ77 match finding against a preset dictionary. The dictionary
+ * is indexed once with hash chains over its leading bytes, and a
+ * message is parsed greedily into literal runs and matches that
+ * point back into the dictionary or the message itself.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "MatchFinder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+const size_t MatchFinder::MinMatch;
+const size_t MatchFinder::MaxMatch;
+
+/* Number of bytes hashed per position */
+static const size_t HashBytes = 4;
+
+/* Size of the dictionary and message hash tables */
+static const unsigned int DictionaryHashBits = 15;
+static const unsigned int MessageHashBits = 10;
+
+/* Number of chain entries searched per position and index */
+static const unsigned int MaxChain = 32;
+
+/**
+ * Hashes the leading bytes of a position.
+ * @param p Pointer to at least HashBytes bytes.
+ * @param nBits Number of bits of the hash.
+ * @result The hash.
+ */
+static inline uint32_t Hash(const unsigned char* p, unsigned int nBits)
+{
+	uint32_t v = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+	return (v * 2654435761u) >> (32 - nBits);
+}
+
+/**
+ * Indexes a dictionary by chaining all positions of equal hash, the
+ * most recent position first.
+ * @param Dictionary Text that messages may reference.
+ */
+MatchFinder::MatchFinder(const string& Dictionary) :
+		dictionary(Dictionary), head(1 << DictionaryHashBits, -1), prev(Dictionary.size(), -1)
+{
+	if (dictionary.size() > (size_t) INT32_MAX)
+		throw std::runtime_error("[MatchFinder] Dictionary too large");
+
+	const unsigned char* pDict = (const unsigned char*) dictionary.data();
+
+	for (size_t i = 0; i + HashBytes <= dictionary.size(); i++)
+	{
+		uint32_t h = Hash(pDict + i, DictionaryHashBits);
+		prev[i] = head[h];
+		head[h] = i;
+	}
+}
+
+/**
+ * Parses characters into literal runs and matches. A match refers to the
+ * concatenation of dictionary and message by its distance behind the
+ * current position and may overlap the current position. Matches are
+ * chosen greedily, the longest of those found along both hash chains.
+ * @param Symbols To be parsed characters.
+ * @result Tokens of which the last one holds no match.
+ */
+vector<MatchFinder::Token> MatchFinder::Parse(const Data& Symbols) const
+{
+	const size_t nDict = dictionary.size();
+	const size_t n = Symbols.size();
+	const unsigned char* pDict = (const unsigned char*) dictionary.data();
+	const unsigned char* pMsg = Symbols.data();
+
+	/* Character of the concatenation of dictionary and message */
+	auto At = [&](size_t v) { return v < nDict ? pDict[v] : pMsg[v - nDict]; };
+
+	vector<int32_t> msgHead(1 << MessageHashBits, -1);
+	vector<int32_t> msgPrev(n, -1);
+
+	vector<Token> tokens;
+	Token token = {0, 0, 0};
+
+	size_t i = 0;
+	size_t nIndexed = 0;
+	while (i < n)
+	{
+		size_t bestLength = 0, bestSource = 0;
+
+		if (i + MinMatch <= n)
+		{
+			const size_t cur = nDict + i;
+
+			/* Length of the match at the source position, at most up to the end of the message */
+			const size_t nMax = std::min(n - i, MaxMatch);
+			auto MatchLength = [&](size_t source) {
+				size_t length = 0;
+				while (length < nMax && At(source + length) == pMsg[i + length])
+					length++;
+				return length;
+			};
+
+			unsigned int nSteps = 0;
+			for (int32_t p = msgHead[Hash(pMsg + i, MessageHashBits)]; p >= 0 && nSteps < MaxChain; p = msgPrev[p], nSteps++)
+			{
+				size_t length = MatchLength(nDict + p);
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestSource = nDict + p;
+				}
+			}
+
+			nSteps = 0;
+			for (int32_t p = head[Hash(pMsg + i, DictionaryHashBits)]; p >= 0 && nSteps < MaxChain; p = prev[p], nSteps++)
+			{
+				size_t length = MatchLength(p);
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestSource = p;
+				}
+			}
+
+			if (bestLength >= MinMatch)
+			{
+				token.length = bestLength;
+				token.distance = cur - bestSource;
+				tokens.push_back(token);
+				token.nLiterals = 0;
+			}
+		}
+
+		size_t next = i + (bestLength >= MinMatch ? bestLength : 1);
+		if (bestLength < MinMatch)
+			token.nLiterals++;
+
+		/* Index the covered positions of the message */
+		for (; nIndexed < next && nIndexed + HashBytes <= n; nIndexed++)
+		{
+			uint32_t h = Hash(pMsg + nIndexed, MessageHashBits);
+			msgPrev[nIndexed] = msgHead[h];
+			msgHead[h] = nIndexed;
+		}
+
+		i = next;
+	}
+
+	token.length = 0;
+	token.distance = 0;
+	tokens.push_back(token);
+
+	return tokens;
+}
+
+/**
+ * Reverses Parse, interleaving literals with the copies of the matches.
+ * @param Tokens Literal runs and matches.
+ * @param Literals Characters of the literal runs in order.
+ * @result Parsed characters.
+ */
+Data MatchFinder::Expand(const vector<Token>& Tokens, const Data& Literals) const
+{
+	const size_t nDict = dictionary.size();
+	Data symbols;
+	size_t nUsed = 0;
+
+	for (vector<Token>::const_iterator it = Tokens.begin(); it != Tokens.end(); it++)
+	{
+		if (it->nLiterals > Literals.size() - nUsed)
+			throw std::runtime_error("[Expand] Too few literals");
+
+		symbols.insert(symbols.end(), Literals.begin() + nUsed, Literals.begin() + nUsed + it->nLiterals);
+		nUsed += it->nLiterals;
+
+		const size_t cur = nDict + symbols.size();
+		if (it->distance == 0 || it->distance > cur)
+		{
+			if (it->length == 0)
+				continue;
+
+			throw std::runtime_error("[Expand] Match distance out of range");
+		}
+
+		/* Copy one at a time, as the match may overlap its own output */
+		for (size_t v = cur - it->distance, end = v + it->length; v < end; v++)
+			symbols.push_back(v < nDict ? (unsigned char) dictionary[v] : symbols[v - nDict]);
+	}
+
+	return symbols;
+}
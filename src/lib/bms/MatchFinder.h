@@ -0,0 +1,54 @@
+/**
+ * MatchFinder.h
+ *
+ * LZ77 match finding against a preset dictionary. The dictionary
+ * is indexed once with hash chains over its leading bytes, and a
+ * message is parsed greedily into literal runs and matches that
+ * point back into the dictionary or the message itself.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_MATCHFINDER_H
+#define BMS_MATCHFINDER_H
+
+#include "Types.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class MatchFinder
+{
+public:
+	/* Shortest match worth referencing and longest match referenced */
+	static const size_t MinMatch = 6;
+	static const size_t MaxMatch = 1 << 16;
+
+	/* Literal run followed by a match, the match being empty in the last token */
+	struct Token
+	{
+		size_t nLiterals;
+		size_t length;
+		size_t distance;
+	};
+
+	/* === Constructors === */
+	explicit MatchFinder(const std::string& Dictionary);
+
+	/* === Accessors === */
+	const std::string& Dictionary() const { return dictionary; }
+
+	/* === Matching === */
+	std::vector<Token> Parse(const Data& Symbols) const;
+	Data Expand(const std::vector<Token>& Tokens, const Data& Literals) const;
+
+private:
+	std::string dictionary;
+	std::vector<int32_t> head;
+	std::vector<int32_t> prev;
+};
+
+#endif
@@ -9,25 +9,74 @@
  */
 
 #include "Maths.h"
-#include <numeric>
 
-namespace mp = boost::multiprecision;
+#include <assert.h>
+#include <map>
+#include <mutex>
+#include <numeric>
 
 
 namespace Math
 {
 
+/* Number of parts for which the factorial table is filled in advance */
+static const uint16_t PrewarmedParts = 14;
+
+/* Maximum number of memoized binomial coefficients */
+static const size_t BinomialCacheSize = 1 << 14;
+
+/**
+ * Computes the factorials up to the largest number of parts, with which
+ * the factorial table starts.
+ * @return Factorials of 0 to PrewarmedParts.
+ */
+static vector<BigInt> PrewarmedFactorials()
+{
+	vector<BigInt> factorials(1, BigInt(1));
+
+	while (factorials.size() <= PrewarmedParts)
+		factorials.push_back(factorials.back() * factorials.size());
+
+	return factorials;
+}
+
+static std::mutex FactorialLock;
+static vector<BigInt> FactorialTable = PrewarmedFactorials();
+
+static std::mutex BinomialLock;
+static std::map<std::pair<uint64_t, uint64_t>, BigInt> BinomialCache;
+
+/**
+ * Selects the smallest integer backend with at least \p nBits bits.
+ * @param nBits Number of bits required by all intermediate results.
+ * @return The integer backend.
+ */
+Backend SelectBackend(uint32_t nBits)
+{
+	if (nBits <= 64)
+		return BACKEND_64;
+	if (nBits <= 128)
+		return BACKEND_128;
+	if (nBits <= 256)
+		return BACKEND_256;
+	if (nBits <= 512)
+		return BACKEND_512;
+
+	return BACKEND_BIGINT;
+}
+
 /**
  * Computes the factorial for a given integer \p n.
  * @param n Integer of which the factorial is to be computed.
  * @return Factorial of the given integer.
  */
-BigInt Factorial(uint16_t n)
+template<typename Int>
+Int Combinatorics<Int>::Factorial(uint16_t n)
 {
-	BigInt fac(1);
+	Int fac(1);
 
 	for (int i = 2; i <= n; i++)
-		fac *= i;
+		fac *= Int(i);
 
 	return fac;
 }
@@ -38,54 +87,194 @@ BigInt Factorial(uint16_t n)
  * @param k Second parameter of the binomial coefficient.
  * @return Resulting binomial coefficient.
  */
-BigInt BinomialCoefficient(uint64_t n, uint64_t k)
+template<typename Int>
+Int Combinatorics<Int>::BinomialCoefficient(uint64_t n, uint64_t k)
 {
 	if (k > n)
 		return 0;
 
-	BigInt result(1);
+	Int result(1);
 	k = std::min(k, n - k);
 
-	for (unsigned i = 1; i < k + 1; ++i)
+	for (uint64_t i = 1; i < k + 1; ++i)
 	{
-		result *= BigInt(n - k + i);
-		result /= BigInt(i);
+		result *= Int(n - k + i);
+		result /= Int(i);
 	}
 
 	return result;
 }
 
+/**
+ * Computes the binomial coefficient (n-1)-choose-k from n-choose-k.
+ * @param Binomial The binomial coefficient n-choose-k.
+ * @param n First parameter of the given binomial coefficient.
+ * @param k Second parameter of the given binomial coefficient.
+ * @return Resulting binomial coefficient.
+ */
+template<typename Int>
+Int Combinatorics<Int>::BinomialStepDown(const Int& Binomial, uint64_t n, uint64_t k)
+{
+	assert(n > 0);
+
+	if (k > n - 1)
+		return 0;
+
+	return Binomial * Int(n - k) / Int(n);
+}
+
+/**
+ * Computes the binomial coefficient (n+1)-choose-k from n-choose-k.
+ * @param Binomial The binomial coefficient n-choose-k.
+ * @param n First parameter of the given binomial coefficient.
+ * @param k Second parameter of the given binomial coefficient.
+ * @return Resulting binomial coefficient.
+ */
+template<typename Int>
+Int Combinatorics<Int>::BinomialStepUp(const Int& Binomial, uint64_t n, uint64_t k)
+{
+	if (k > n + 1)
+		return 0;
+	if (k == n + 1)
+		return 1;
+
+	return Binomial * Int(n + 1) / Int(n + 1 - k);
+}
+
 /**
  * Computes the number of combinatorial compositions of an integer \p n into \p k parts.
  * @param n Integer to be split.
  * @param k Number of parts.
  * @return Number of compositions.
  */
-BigInt NumberCompositions(uint64_t n, uint16_t k)
+template<typename Int>
+Int Combinatorics<Int>::NumberCompositions(uint64_t n, uint16_t k)
 {
 	return BinomialCoefficient(n + k - 1, k - 1);
 }
 
 /**
- * Computes the lexicographic index for a given permutation.
- * @param Permutation The permutation.
- * @return Lexicographic index of the permutation.
+ * Binary indexed tree over the elements 0..n-1 of a permutation,
+ * counting how many of them are marked.
  */
-BigInt PermutationToInteger(const vector<uint16_t>& Permutation)
+class FenwickTree
 {
-	const unsigned int PermSize = Permutation.size();
-	BigInt idx = 0;
+public:
+	FenwickTree(uint16_t n, bool bMarked) : tree(n + 1, 0)
+	{
+		/* With all elements marked every node covers its full range */
+		if (bMarked)
+		{
+			for (unsigned int i = 1; i < tree.size(); i++)
+				tree[i] = i & -i;
+		}
+	}
+
+	void Add(uint16_t elem, int delta)
+	{
+		for (unsigned int i = elem + 1; i < tree.size(); i += i & -i)
+			tree[i] += delta;
+	}
 
-	for (unsigned int i = 0; i <= PermSize - 2; i++)
+	/* Number of marked elements smaller than elem */
+	unsigned int CountBelow(uint16_t elem) const
 	{
-		int a = 0;
-		for (unsigned int j = i + 1; j <= PermSize - 1; j++)
+		unsigned int count = 0;
+		for (unsigned int i = elem; i > 0; i -= i & -i)
+			count += tree[i];
+
+		return count;
+	}
+
+	/* The marked element with exactly nth marked elements below it */
+	uint16_t FindNth(unsigned int nth) const
+	{
+		unsigned int pos = 0;
+		unsigned int step = 1;
+		while (2 * step < tree.size())
+			step *= 2;
+
+		for (; step > 0; step /= 2)
 		{
-			if (Permutation[i] > Permutation[j])
-				a++;
+			if (pos + step < tree.size() && (unsigned int) tree[pos + step] <= nth)
+			{
+				pos += step;
+				nth -= tree[pos];
+			}
 		}
 
-		idx += a * Factorial(PermSize - i - 1);
+		return pos;
+	}
+
+private:
+	vector<int> tree;
+};
+
+/**
+ * Computes the digits of the lexicographic index of a permutation in the
+ * factorial number system, i.e. the number of smaller elements to the right
+ * of each element.
+ * @param Permutation The permutation.
+ * @return Digits of the index, most significant first.
+ */
+vector<uint16_t> PermutationToDigits(const vector<uint16_t>& Permutation)
+{
+	const uint16_t PermSize = Permutation.size();
+
+	vector<uint16_t> digits(PermSize);
+	FenwickTree seen(PermSize, false);
+
+	for (int i = PermSize - 1; i >= 0; i--)
+	{
+		assert(Permutation[i] < PermSize);
+
+		digits[i] = seen.CountBelow(Permutation[i]);
+		seen.Add(Permutation[i], 1);
+	}
+
+	return digits;
+}
+
+/**
+ * Computes the permutation from the digits of its lexicographic index
+ * in the factorial number system.
+ * @param Digits Digits of the index, most significant first.
+ * @return The resulting permutation.
+ */
+vector<uint16_t> DigitsToPermutation(const vector<uint16_t>& Digits)
+{
+	const uint16_t PermSize = Digits.size();
+
+	vector<uint16_t> perm(PermSize);
+	FenwickTree unused(PermSize, true);
+
+	for (unsigned int i = 0; i < PermSize; i++)
+	{
+		assert(Digits[i] < PermSize - i);
+
+		perm[i] = unused.FindNth(Digits[i]);
+		unused.Add(perm[i], -1);
+	}
+
+	return perm;
+}
+
+/**
+ * Computes the lexicographic index for a given permutation.
+ * @param Permutation The permutation.
+ * @return Lexicographic index of the permutation.
+ */
+template<typename Int>
+Int Combinatorics<Int>::PermutationToInteger(const vector<uint16_t>& Permutation)
+{
+	const uint16_t PermSize = Permutation.size();
+	const vector<uint16_t> digits = PermutationToDigits(Permutation);
+
+	Int idx = 0;
+	for (unsigned int i = 0; i < PermSize; i++)
+	{
+		idx *= Int(PermSize - i);
+		idx += Int(digits[i]);
 	}
 
 	return idx;
@@ -97,23 +286,19 @@ BigInt PermutationToInteger(const vector<uint16_t>& Permutation)
  * @param k Number of elements in the permutation.
  * @return The resulting permutation.
  */
-vector<uint16_t> IntegerToPermutation(BigInt idx, uint16_t k)
+template<typename Int>
+vector<uint16_t> Combinatorics<Int>::IntegerToPermutation(Int idx, uint16_t k)
 {
-	vector<uint16_t> perm(k);
-	vector<uint16_t> buf(k);
-	std::iota(buf.begin(), buf.end(), 0);
+	/* Factorial number system digits, least significant first */
+	vector<uint16_t> digits(k);
 
-	BigInt x = 0;
-	for (int i = 0; i <= k - 1; i++)
+	for (unsigned int radix = 1; radix <= k; radix++)
 	{
-		x = (idx / Factorial(k - i - 1));
-		perm[i] = buf[x.convert_to<int>()];
-
-		idx -= x * Factorial(k - i - 1);
-		buf.erase(std::remove(buf.begin(), buf.end(), perm[i]), buf.end());
+		digits[k - radix] = static_cast<uint16_t>(Int(idx % Int(radix)));
+		idx /= Int(radix);
 	}
 
-	return perm;
+	return DigitsToPermutation(digits);
 }
 
 /**
@@ -121,12 +306,13 @@ vector<uint16_t> IntegerToPermutation(BigInt idx, uint16_t k)
  * @param Composition Compositions of which the index is to be computed.
  * @return Lexicographic index of the composition.
  */
-BigInt CompositionToInteger(const vector<uint64_t>& Composition)
+template<typename Int>
+Int Combinatorics<Int>::CompositionToInteger(const vector<uint64_t>& Composition)
 {
 	const uint64_t N = std::accumulate(Composition.begin(), Composition.end(), (uint64_t) 0);
 	const uint16_t K = Composition.size();
 
-	BigInt idx = 0;
+	Int idx = 0;
 	uint64_t n = N;
 	uint16_t k = K;
 
@@ -141,6 +327,72 @@ BigInt CompositionToInteger(const vector<uint64_t>& Composition)
 	return idx;
 }
 
+/**
+ * Finds the smallest remainder m <= n for which the number of compositions
+ * of m into k parts reaches \p Target, by galloping down from n and then
+ * bisecting the bracket. The last few steps reuse the previous count.
+ * @param Target Number of compositions to be reached, at least one.
+ * @param n Largest remainder.
+ * @param k Number of parts.
+ * @param Count Number of compositions of n into k parts on entry, of m into k parts on return.
+ * @return The remainder m.
+ */
+template<typename Int>
+uint64_t Combinatorics<Int>::SmallestRemainder(const Int& Target, uint64_t n, uint16_t k, Int& Count)
+{
+	/* Maximum bracket width that is walked step by step */
+	const uint64_t LinearSteps = 8;
+
+	uint64_t hi = n;
+	uint64_t lo = 0;
+	uint64_t gap = 1;
+	Int c;
+
+	/* Gallop until NumberCompositions(lo, k) < Target <= NumberCompositions(hi, k) */
+	while (true)
+	{
+		if (hi == 0)
+			return 0;
+
+		lo = (gap < hi) ? hi - gap : 0;
+		c = NumberCompositions(lo, k);
+		if (c < Target)
+			break;
+
+		hi = lo;
+		Count = c;
+		gap *= 2;
+	}
+
+	while (hi - lo > LinearSteps)
+	{
+		uint64_t mid = lo + (hi - lo) / 2;
+		c = NumberCompositions(mid, k);
+
+		if (c < Target)
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+			Count = c;
+		}
+	}
+
+	while (hi - 1 > lo)
+	{
+		c = BinomialStepDown(Count, hi + k - 1, k - 1);
+		if (c < Target)
+			break;
+
+		hi--;
+		Count = c;
+	}
+
+	return hi;
+}
+
 /**
  * Computes the combinatorial composition from its lexicographic index,
  * the integer \p n and its number of elements \p k.
@@ -148,34 +400,30 @@ BigInt CompositionToInteger(const vector<uint64_t>& Composition)
  * @param k Number of composition parts.
  * @return The resulting composition.
  */
-vector<uint64_t> IntegerToComposition(BigInt idx, uint64_t n, uint16_t k)
+template<typename Int>
+vector<uint64_t> Combinatorics<Int>::IntegerToComposition(Int idx, uint64_t n, uint16_t k)
 {
 	const uint16_t K = k;
 	vector<uint64_t> composition(K);
 
-	BigInt A;
-	BigFloat root;
-	uint64_t mu;
+	Int total = NumberCompositions(n, k);
+	Int count;
+	uint64_t m;
 
 	for (int i = 0; i <= K - 2; i++)
 	{
 		if (n == 0)
 			break;
 
-		A = (NumberCompositions(n, k) - idx) * Factorial(k - 1);
-		root = mp::round(mp::pow(BigFloat(A), BigFloat(1.0 / (k - 1))));
-		mu = n - root.convert_to<uint64_t>() - (k - 1) / 2;
+		/* The first part leaves the smallest remainder that still has more than idx compositions ahead of it */
+		count = total;
+		m = SmallestRemainder(total - idx, n, k, count);
 
-		while (!(NumberCompositions(n - mu - 1, k)
-				< NumberCompositions(n, k) - idx))
-			mu++;
-		while (!(NumberCompositions(n, k) - idx <= NumberCompositions(n - mu, k)))
-			mu--;
+		composition[i] = n - m;
 
-		composition[i] = mu;
-
-		idx -= (NumberCompositions(n, k) - NumberCompositions(n - mu, k));
-		n -= mu;
+		idx -= (total - count);
+		total = count * Int(k - 1) / Int(m + k - 1);
+		n = m;
 		k -= 1;
 	}
 
@@ -184,4 +432,117 @@ vector<uint64_t> IntegerToComposition(BigInt idx, uint64_t n, uint16_t k)
 	return composition;
 }
 
+/* === Arbitrary precision === */
+
+/**
+ * Computes the factorial for a given integer \p n from a shared table.
+ * @param n Integer of which the factorial is to be computed.
+ * @return Factorial of the given integer.
+ */
+template<>
+BigInt Combinatorics<BigInt>::Factorial(uint16_t n)
+{
+	std::lock_guard<std::mutex> guard(FactorialLock);
+
+	while (FactorialTable.size() <= n)
+		FactorialTable.push_back(FactorialTable.back() * FactorialTable.size());
+
+	return FactorialTable[n];
+}
+
+/**
+ * Computes the binomial coefficient n-choose-k, memoizing the result.
+ * @param n First parameter of the binomial coefficient.
+ * @param k Second parameter of the binomial coefficient.
+ * @return Resulting binomial coefficient.
+ */
+template<>
+BigInt Combinatorics<BigInt>::BinomialCoefficient(uint64_t n, uint64_t k)
+{
+	if (k > n)
+		return 0;
+
+	k = std::min(k, n - k);
+	if (k == 0)
+		return 1;
+
+	const std::pair<uint64_t, uint64_t> key(n, k);
+	{
+		std::lock_guard<std::mutex> guard(BinomialLock);
+
+		auto it = BinomialCache.find(key);
+		if (it != BinomialCache.end())
+			return it->second;
+	}
+
+	BigInt result(1);
+
+	for (uint64_t i = 1; i < k + 1; ++i)
+	{
+		result *= BigInt(n - k + i);
+		result /= BigInt(i);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(BinomialLock);
+
+		if (BinomialCache.size() >= BinomialCacheSize)
+			BinomialCache.clear();
+		BinomialCache[key] = result;
+	}
+
+	return result;
+}
+
+template struct Combinatorics<UInt64>;
+template struct Combinatorics<UInt128>;
+template struct Combinatorics<UInt256>;
+template struct Combinatorics<UInt512>;
+template struct Combinatorics<BigInt>;
+
+BigInt Factorial(uint16_t n)
+{
+	return Combinatorics<BigInt>::Factorial(n);
+}
+
+BigInt BinomialCoefficient(uint64_t n, uint64_t k)
+{
+	return Combinatorics<BigInt>::BinomialCoefficient(n, k);
+}
+
+BigInt BinomialStepDown(const BigInt& Binomial, uint64_t n, uint64_t k)
+{
+	return Combinatorics<BigInt>::BinomialStepDown(Binomial, n, k);
+}
+
+BigInt BinomialStepUp(const BigInt& Binomial, uint64_t n, uint64_t k)
+{
+	return Combinatorics<BigInt>::BinomialStepUp(Binomial, n, k);
+}
+
+BigInt NumberCompositions(uint64_t n, uint16_t k)
+{
+	return Combinatorics<BigInt>::NumberCompositions(n, k);
+}
+
+BigInt PermutationToInteger(const vector<uint16_t>& Permutation)
+{
+	return Combinatorics<BigInt>::PermutationToInteger(Permutation);
+}
+
+vector<uint16_t> IntegerToPermutation(BigInt idx, uint16_t k)
+{
+	return Combinatorics<BigInt>::IntegerToPermutation(idx, k);
+}
+
+BigInt CompositionToInteger(const vector<uint64_t>& Composition)
+{
+	return Combinatorics<BigInt>::CompositionToInteger(Composition);
+}
+
+vector<uint64_t> IntegerToComposition(BigInt idx, uint64_t n, uint16_t k)
+{
+	return Combinatorics<BigInt>::IntegerToComposition(idx, n, k);
+}
+
 }
@@ -15,10 +15,63 @@
 
 namespace Math
 {
+	/* === Fixed-width integer backends === */
+	typedef uint64_t UInt64;
+#ifdef __SIZEOF_INT128__
+	typedef unsigned __int128 UInt128;
+#else
+	typedef boost::multiprecision::number<boost::multiprecision::cpp_int_backend<128, 128,
+			boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void> > UInt128;
+#endif
+	typedef boost::multiprecision::number<boost::multiprecision::cpp_int_backend<256, 256,
+			boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void> > UInt256;
+	typedef boost::multiprecision::number<boost::multiprecision::cpp_int_backend<512, 512,
+			boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void> > UInt512;
+
+	enum Backend
+	{
+		BACKEND_64,
+		BACKEND_128,
+		BACKEND_256,
+		BACKEND_512,
+		BACKEND_BIGINT
+	};
+
+	Backend SelectBackend(uint32_t nBits);
+
+	/**
+	 * Combinatorial functions over an integer backend. Intermediate results
+	 * of the backend must have room for the largest count plus the bit length
+	 * of its parameters. Instantiated for all backends above and for BigInt.
+	 */
+	template<typename Int>
+	struct Combinatorics
+	{
+		static Int Factorial(uint16_t n);
+		static Int BinomialCoefficient(uint64_t n, uint64_t k);
+		static Int BinomialStepDown(const Int& Binomial, uint64_t n, uint64_t k);
+		static Int BinomialStepUp(const Int& Binomial, uint64_t n, uint64_t k);
+		static Int NumberCompositions(uint64_t n, uint16_t k);
+
+		static Int PermutationToInteger(const std::vector<uint16_t>& Permutation);
+		static std::vector<uint16_t> IntegerToPermutation(Int idx, uint16_t k);
+
+		static Int CompositionToInteger(const std::vector<uint64_t>& Composition);
+		static std::vector<uint64_t> IntegerToComposition(Int idx, uint64_t n, uint16_t k);
+
+	private:
+		static uint64_t SmallestRemainder(const Int& Target, uint64_t n, uint16_t k, Int& Count);
+	};
+
 	BigInt Factorial(uint16_t n);
 	BigInt BinomialCoefficient(uint64_t n, uint64_t k);
+	BigInt BinomialStepDown(const BigInt& Binomial, uint64_t n, uint64_t k);
+	BigInt BinomialStepUp(const BigInt& Binomial, uint64_t n, uint64_t k);
 	BigInt NumberCompositions(uint64_t n, uint16_t k);
 
+	std::vector<uint16_t> PermutationToDigits(const std::vector<uint16_t>& Permutation);
+	std::vector<uint16_t> DigitsToPermutation(const std::vector<uint16_t>& Digits);
+
 	BigInt PermutationToInteger(const std::vector<uint16_t>& Permutation);
 	std::vector<uint16_t> IntegerToPermutation(BigInt idx, uint16_t k);
 
@@ -0,0 +1,261 @@
+/**
+ * Random.cpp
+ *
+ * Cryptographically secure random number generation. Every thread
+ * owns a ChaCha20 generator that is seeded once from OpenSSL and
+ * rekeys itself from its own output after each buffer refill, so
+ * that drawing random bytes costs no system calls and past output
+ * cannot be recovered from the generator state.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "Random.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdexcept>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+
+namespace Random
+{
+
+const size_t ChaCha20::KeySize;
+const size_t ChaCha20::BlockSize;
+
+/* "expand 32-byte k" */
+static const uint32_t Sigma[4] = {0x61707865, 0x3320646E, 0x79622D32, 0x6B206574};
+
+static inline uint32_t ReadLE32(const unsigned char* p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline void WriteLE32(unsigned char* p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static inline uint32_t Rotl(uint32_t v, int n)
+{
+	return (v << n) | (v >> (32 - n));
+}
+
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d = Rotl(d ^ a, 16); \
+	c += d; b = Rotl(b ^ c, 12); \
+	a += b; d = Rotl(d ^ a, 8); \
+	c += d; b = Rotl(b ^ c, 7);
+
+/**
+ * Computes a single keystream block from the input state.
+ * @param Input The state of key, counter and nonce.
+ * @param pOut Buffer of 64 bytes for the keystream block.
+ */
+static void Block(const uint32_t Input[16], unsigned char* pOut)
+{
+	uint32_t x[16];
+	memcpy(x, Input, sizeof(x));
+
+	for (int i = 0; i < 10; i++)
+	{
+		QUARTERROUND(x[0], x[4], x[8], x[12]);
+		QUARTERROUND(x[1], x[5], x[9], x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8], x[13]);
+		QUARTERROUND(x[3], x[4], x[9], x[14]);
+	}
+
+	for (int i = 0; i < 16; i++)
+		WriteLE32(pOut + 4 * i, x[i] + Input[i]);
+}
+
+#undef QUARTERROUND
+
+/**
+ * Sets up the cipher with a 64-bit block counter starting at zero.
+ * @param pKey Key of 32 bytes.
+ * @param nonce Nonce of the keystream.
+ */
+ChaCha20::ChaCha20(const unsigned char* pKey, uint64_t nonce)
+{
+	for (int i = 0; i < 4; i++)
+		input[i] = Sigma[i];
+	for (int i = 0; i < 8; i++)
+		input[4 + i] = ReadLE32(pKey + 4 * i);
+
+	input[12] = 0;
+	input[13] = 0;
+	input[14] = nonce;
+	input[15] = nonce >> 32;
+}
+
+/**
+ * Positions the keystream at the start of a block.
+ * @param nBlock Index of the block.
+ */
+void ChaCha20::Seek(uint64_t nBlock)
+{
+	input[12] = nBlock;
+	input[13] = nBlock >> 32;
+}
+
+/**
+ * Writes the next bytes of the keystream. The remainder of a trailing
+ * partial block is skipped, so the next call starts at a block boundary.
+ * @param pOut Buffer for the keystream.
+ * @param nBytes Number of bytes.
+ */
+void ChaCha20::Keystream(unsigned char* pOut, size_t nBytes)
+{
+	unsigned char block[BlockSize];
+
+	while (nBytes > 0)
+	{
+		if (nBytes >= BlockSize)
+		{
+			Block(input, pOut);
+		}
+		else
+		{
+			Block(input, block);
+			memcpy(pOut, block, nBytes);
+			OPENSSL_cleanse(block, BlockSize);
+		}
+
+		if (++input[12] == 0)
+			input[13]++;
+
+		size_t n = std::min(nBytes, BlockSize);
+		pOut += n;
+		nBytes -= n;
+	}
+}
+
+/** Thread-local generator with fast key erasure. */
+class Generator
+{
+public:
+	static const size_t BufferSize = 16 * ChaCha20::BlockSize;
+
+	Generator() : pos(BufferSize)
+	{
+		if (RAND_bytes(key, ChaCha20::KeySize) != 1)
+			throw std::runtime_error("[Random] Seeding the generator failed");
+	}
+
+	~Generator()
+	{
+		OPENSSL_cleanse(key, sizeof(key));
+		OPENSSL_cleanse(buffer, sizeof(buffer));
+	}
+
+	void Fill(unsigned char* pData, size_t nBytes)
+	{
+		/* Large requests come straight from a keystream under a one-off key */
+		if (nBytes >= BufferSize)
+		{
+			unsigned char oneOffKey[ChaCha20::KeySize];
+			Fill(oneOffKey, sizeof(oneOffKey));
+			ChaCha20(oneOffKey).Keystream(pData, nBytes);
+			OPENSSL_cleanse(oneOffKey, sizeof(oneOffKey));
+			return;
+		}
+
+		while (nBytes > 0)
+		{
+			if (pos == BufferSize)
+				Refill();
+
+			size_t n = std::min(nBytes, BufferSize - pos);
+			memcpy(pData, buffer + pos, n);
+			memset(buffer + pos, 0, n);
+
+			pos += n;
+			pData += n;
+			nBytes -= n;
+		}
+	}
+
+private:
+	unsigned char key[ChaCha20::KeySize];
+	unsigned char buffer[BufferSize];
+	size_t pos;
+
+	/* Refills the buffer and replaces the key with its first bytes */
+	void Refill()
+	{
+		ChaCha20(key).Keystream(buffer, BufferSize);
+		memcpy(key, buffer, ChaCha20::KeySize);
+		memset(buffer, 0, ChaCha20::KeySize);
+		pos = ChaCha20::KeySize;
+	}
+
+	Generator(const Generator&);
+	Generator& operator=(const Generator&);
+};
+
+/**
+ * Fills a buffer with cryptographically secure random bytes from the
+ * generator of the calling thread.
+ * @param pData Buffer to be filled.
+ * @param nBytes Number of bytes.
+ */
+void Fill(unsigned char* pData, size_t nBytes)
+{
+	static thread_local Generator generator;
+	generator.Fill(pData, nBytes);
+}
+
+/** Creates a reader with no bits drawn yet. */
+BitReader::BitReader() : word(0), nAvailable(0)
+{
+}
+
+/**
+ * Reads random bits, drawing eight bytes at a time from the generator.
+ * @param nBits Number of bits, between 1 and 64.
+ * @result The bits in the least significant positions.
+ */
+uint64_t BitReader::Read(unsigned int nBits)
+{
+	assert(1 <= nBits && nBits <= 64);
+
+	uint64_t result = 0;
+	while (nBits > 0)
+	{
+		if (nAvailable == 0)
+		{
+			Fill((unsigned char*) &word, sizeof(word));
+			nAvailable = 64;
+		}
+
+		unsigned int n = std::min(nBits, nAvailable);
+		if (n == 64)
+		{
+			result = word;
+		}
+		else
+		{
+			result = (result << n) | (word & ((1ULL << n) - 1));
+			word >>= n;
+		}
+
+		nAvailable -= n;
+		nBits -= n;
+	}
+
+	return result;
+}
+
+}
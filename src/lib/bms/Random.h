@@ -0,0 +1,57 @@
+/**
+ * Random.h
+ *
+ * Cryptographically secure random number generation. Every thread
+ * owns a ChaCha20 generator that is seeded once from OpenSSL and
+ * rekeys itself from its own output after each buffer refill, so
+ * that drawing random bytes costs no system calls and past output
+ * cannot be recovered from the generator state.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_RANDOM_H
+#define BMS_RANDOM_H
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace Random
+{
+	class ChaCha20
+	{
+	public:
+		static const size_t KeySize = 32;
+		static const size_t BlockSize = 64;
+
+		/* === Constructors === */
+		explicit ChaCha20(const unsigned char* pKey, uint64_t nonce = 0);
+
+		/* === Keystream === */
+		void Seek(uint64_t nBlock);
+		void Keystream(unsigned char* pOut, size_t nBytes);
+
+	private:
+		uint32_t input[16];
+	};
+
+	class BitReader
+	{
+	public:
+		/* === Constructors === */
+		BitReader();
+
+		/* === Bit access === */
+		uint64_t Read(unsigned int nBits);
+		bool ReadBit() { return Read(1) != 0; }
+
+	private:
+		uint64_t word;
+		unsigned int nAvailable;
+	};
+
+	void Fill(unsigned char* pData, size_t nBytes);
+};
+
+#endif
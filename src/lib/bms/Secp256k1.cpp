@@ -0,0 +1,264 @@
+/**
+ * Secp256k1.cpp
+ *
+ * Field arithmetic over the prime of the secp256k1 curve for
+ * checking whether candidate x-coordinates of compressed public
+ * keys lie on the curve, without decoding them with OpenSSL.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "Secp256k1.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef __SIZEOF_INT128__
+#include <boost/multiprecision/cpp_int.hpp>
+#endif
+
+namespace Secp256k1
+{
+
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned __int128 uint128_t;
+
+/* Field element as four 64-bit limbs, least significant first */
+typedef uint64_t FieldElement[4];
+
+/* The field prime p = 2^256 - 2^32 - 977 */
+static const FieldElement Prime = {
+		0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL,
+		0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+
+/* 2^256 mod p */
+static const uint64_t Fold = 0x1000003D1ULL;
+
+/** Reduces a field element below 2^256 to its canonical form below p. */
+static inline void Normalize(FieldElement r)
+{
+	if (r[3] == Prime[3] && r[2] == Prime[2] && r[1] == Prime[1] && r[0] >= Prime[0])
+	{
+		/* r - p = r + 2^32 + 977 - 2^256 */
+		uint128_t c = (uint128_t) r[0] + Fold;
+		r[0] = (uint64_t) c;
+		for (int i = 1; i < 4; i++)
+		{
+			c = (c >> 64) + r[i];
+			r[i] = (uint64_t) c;
+		}
+	}
+}
+
+/** Reduces a 512-bit product modulo p. */
+static inline void Reduce(const uint64_t t[8], FieldElement r)
+{
+	uint128_t c = 0;
+
+	/* Fold the upper half in with 2^256 = 2^32 + 977 (mod p) */
+	for (int i = 0; i < 4; i++)
+	{
+		c += (uint128_t) t[4 + i] * Fold + t[i];
+		r[i] = (uint64_t) c;
+		c >>= 64;
+	}
+
+	/* Fold the remaining carry of at most 34 bits in again */
+	c = (uint128_t) (uint64_t) c * Fold;
+	for (int i = 0; i < 4; i++)
+	{
+		c += r[i];
+		r[i] = (uint64_t) c;
+		c >>= 64;
+	}
+
+	/* A final overflow leaves a small value, so one more fold cannot carry out */
+	if (c != 0)
+	{
+		c = (uint128_t) r[0] + Fold;
+		r[0] = (uint64_t) c;
+		for (int i = 1; i < 4; i++)
+		{
+			c = (c >> 64) + r[i];
+			r[i] = (uint64_t) c;
+		}
+	}
+
+	Normalize(r);
+}
+
+static inline void Mul(const FieldElement a, const FieldElement b, FieldElement r)
+{
+	uint64_t t[8] = {0};
+
+	for (int i = 0; i < 4; i++)
+	{
+		uint128_t c = 0;
+		for (int j = 0; j < 4; j++)
+		{
+			c += (uint128_t) a[i] * b[j] + t[i + j];
+			t[i + j] = (uint64_t) c;
+			c >>= 64;
+		}
+		t[i + 4] = (uint64_t) c;
+	}
+
+	Reduce(t, r);
+}
+
+/** Squares a field element \p n times. */
+static inline void SqrN(const FieldElement a, int n, FieldElement r)
+{
+	if (r != a)
+		memcpy(r, a, sizeof(FieldElement));
+
+	for (int i = 0; i < n; i++)
+		Mul(r, r, r);
+}
+
+/**
+ * Checks whether a field element is a square, by computing the candidate
+ * root a^((p+1)/4) with the addition chain of libsecp256k1 and squaring it.
+ */
+static bool IsSquare(const FieldElement a)
+{
+	FieldElement x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t;
+
+	Mul(a, a, x2);
+	Mul(x2, a, x2);
+
+	Mul(x2, x2, x3);
+	Mul(x3, a, x3);
+
+	SqrN(x3, 3, x6);
+	Mul(x6, x3, x6);
+
+	SqrN(x6, 3, x9);
+	Mul(x9, x3, x9);
+
+	SqrN(x9, 2, x11);
+	Mul(x11, x2, x11);
+
+	SqrN(x11, 11, x22);
+	Mul(x22, x11, x22);
+
+	SqrN(x22, 22, x44);
+	Mul(x44, x22, x44);
+
+	SqrN(x44, 44, x88);
+	Mul(x88, x44, x88);
+
+	SqrN(x88, 88, x176);
+	Mul(x176, x88, x176);
+
+	SqrN(x176, 44, x220);
+	Mul(x220, x44, x220);
+
+	SqrN(x220, 3, x223);
+	Mul(x223, x3, x223);
+
+	SqrN(x223, 23, t);
+	Mul(t, x22, t);
+	SqrN(t, 6, t);
+	Mul(t, x2, t);
+	SqrN(t, 2, t);
+
+	Mul(t, t, t);
+
+	return memcmp(t, a, sizeof(FieldElement)) == 0;
+}
+
+/**
+ * Checks whether a big-endian x-coordinate belongs to a point on the curve,
+ * i.e. whether it is below p and x^3 + 7 is a square modulo p.
+ * @param pX The x-coordinate of 32 bytes.
+ * @result True if the x-coordinate is valid. Otherwise not.
+ */
+bool IsValidX(const unsigned char* pX)
+{
+	FieldElement x;
+	for (int i = 0; i < 4; i++)
+	{
+		x[3 - i] = 0;
+		for (int j = 0; j < 8; j++)
+			x[3 - i] = (x[3 - i] << 8) | pX[8 * i + j];
+	}
+
+	if (x[3] == Prime[3] && x[2] == Prime[2] && x[1] == Prime[1] && x[0] >= Prime[0])
+		return false;
+
+	FieldElement y2;
+	Mul(x, x, y2);
+	Mul(y2, x, y2);
+
+	/* y^2 = x^3 + 7 */
+	uint128_t c = (uint128_t) y2[0] + 7;
+	y2[0] = (uint64_t) c;
+	for (int i = 1; i < 4; i++)
+	{
+		c = (c >> 64) + y2[i];
+		y2[i] = (uint64_t) c;
+	}
+	if ((c >> 64) != 0)
+	{
+		/* Wrapped past 2^256, so add 2^256 mod p back on top of a small value */
+		c = (uint128_t) y2[0] + Fold;
+		y2[0] = (uint64_t) c;
+		for (int i = 1; i < 4; i++)
+		{
+			c = (c >> 64) + y2[i];
+			y2[i] = (uint64_t) c;
+		}
+	}
+	Normalize(y2);
+
+	return IsSquare(y2);
+}
+
+#else
+
+/**
+ * Checks whether a big-endian x-coordinate belongs to a point on the curve,
+ * i.e. whether it is below p and x^3 + 7 is a square modulo p.
+ * @param pX The x-coordinate of 32 bytes.
+ * @result True if the x-coordinate is valid. Otherwise not.
+ */
+bool IsValidX(const unsigned char* pX)
+{
+	namespace mp = boost::multiprecision;
+
+	static const mp::cpp_int Prime("0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F");
+
+	mp::cpp_int x;
+	mp::import_bits(x, pX, pX + CoordinateSize);
+	if (x >= Prime)
+		return false;
+
+	/* Euler's criterion */
+	mp::cpp_int y2 = (x * x * x + 7) % Prime;
+	return y2 == 0 || mp::powm(y2, (Prime - 1) / 2, Prime) == 1;
+}
+
+#endif
+
+/**
+ * Finds the first of a batch of big-endian x-coordinates that belongs to
+ * a point on the curve.
+ * @param pXs Consecutive x-coordinates of 32 bytes each.
+ * @param nCandidates Number of x-coordinates.
+ * @result Index of the first valid x-coordinate, or \p nCandidates if there is none.
+ */
+size_t FindValidX(const unsigned char* pXs, size_t nCandidates)
+{
+	for (size_t i = 0; i < nCandidates; i++)
+	{
+		if (IsValidX(pXs + i * CoordinateSize))
+			return i;
+	}
+
+	return nCandidates;
+}
+
+}
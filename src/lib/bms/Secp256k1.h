@@ -0,0 +1,26 @@
+/**
+ * Secp256k1.h
+ *
+ * Field arithmetic over the prime of the secp256k1 curve for
+ * checking whether candidate x-coordinates of compressed public
+ * keys lie on the curve, without decoding them with OpenSSL.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_SECP256K1_H
+#define BMS_SECP256K1_H
+
+#include <cstddef>
+
+namespace Secp256k1
+{
+	/* Size of an x-coordinate in bytes */
+	const size_t CoordinateSize = 32;
+
+	bool IsValidX(const unsigned char* pX);
+	size_t FindValidX(const unsigned char* pXs, size_t nCandidates);
+};
+
+#endif
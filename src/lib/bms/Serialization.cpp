@@ -9,6 +9,7 @@
  */
 
 #include "Serialization.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -96,6 +97,405 @@ HuffCodeMap DeserializeHuffmanCode(const string& Path)
 	return codes;
 }
 
+/* Leading bytes and version of a binary code table */
+static const char CodeTableMagic[4] = {'B', 'M', 'S', 'H'};
+static const unsigned char CodeTableVersion = 1;
+
+/* Flag of code tables storing the codes themselves besides their lengths */
+static const unsigned char CodeTableExplicit = 0x01;
+
+/**
+ * Serializes a Huffman code to a specified location in a compact binary
+ * format. It starts with the bytes "BMSH", a version byte, a flag byte
+ * and the number of codes less one. Then follow the character and code
+ * length of every code, in ascending byte order. Canonical codes are fully
+ * described by their lengths; for any other code the flag is set and every
+ * length is followed by the code itself, padded to whole bytes.
+ * @param Codes To be serialized Huffman code mapping.
+ * @param Path Path to where the mapping is to be serialized.
+ */
+void SerializeCodeTable(const HuffCodeMap& Codes, const string& Path)
+{
+	if (Codes.empty() || Codes.size() > 256)
+		throw std::runtime_error("[SerializeCodeTable] Invalid number of codes");
+
+	const bool Explicit = !HuffmanCoding::IsCanonical(Codes);
+	map<unsigned char, HuffCode> ordered;
+
+	for (HuffCodeMap::left_const_iterator it = Codes.left.begin(); it != Codes.left.end(); it++)
+	{
+		if (it->second.empty() || it->second.size() > 255)
+			throw std::runtime_error("[SerializeCodeTable] Invalid code length");
+
+		ordered[(unsigned char) it->first] = it->second;
+	}
+
+	string buf(CodeTableMagic, sizeof(CodeTableMagic));
+	buf += (char) CodeTableVersion;
+	buf += (char) (Explicit ? CodeTableExplicit : 0);
+	buf += (char) (ordered.size() - 1);
+
+	for (map<unsigned char, HuffCode>::const_iterator it = ordered.begin(); it != ordered.end(); it++)
+	{
+		buf += (char) it->first;
+		buf += (char) it->second.size();
+
+		if (Explicit)
+		{
+			for (size_t i = 0; i < it->second.size(); i += 8)
+			{
+				unsigned char byte = 0;
+				for (size_t j = i; j < i + 8; j++)
+					byte = (byte << 1) | (j < it->second.size() && it->second[j]);
+
+				buf += (char) byte;
+			}
+		}
+	}
+
+	fs::ofstream ofs(Path, std::ios::binary);
+	if (!ofs.good())
+	{
+		string err;
+		err += "[SerializeCodeTable] Failed to open output stream";
+		err += "\nPath: ";
+		err += Path;
+		throw std::runtime_error(err);
+	}
+
+	ofs.write(buf.data(), buf.size());
+	ofs.close();
+}
+
+/**
+ * Checks whether no code of a Huffman coding is the prefix of another. In
+ * lexicographic order a code that is the prefix of others directly
+ * precedes one of them.
+ * @param Codes Huffman coding of characters.
+ * @result True if the coding is prefix-free. Otherwise not.
+ */
+static bool IsPrefixFree(const HuffCodeMap& Codes)
+{
+	vector<HuffCode> sorted;
+	for (HuffCodeMap::left_const_iterator it = Codes.left.begin(); it != Codes.left.end(); it++)
+		sorted.push_back(it->second);
+
+	std::sort(sorted.begin(), sorted.end());
+
+	for (size_t i = 1; i < sorted.size(); i++)
+	{
+		if (std::equal(sorted[i - 1].begin(), sorted[i - 1].end(), sorted[i].begin()))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Deserializes a Huffman code in the compact binary format from a specified location.
+ * Tables that SerializeCodeTable would not write, or whose codes are not
+ * prefix-free, are rejected, as they would silently corrupt messages.
+ * @param Path Path to where the Huffman code mapping is stored.
+ * @result The stored Huffman code mapping.
+ */
+HuffCodeMap DeserializeCodeTable(const string& Path)
+{
+	fs::ifstream ifs(Path, std::ios::binary);
+	if (!ifs.good())
+	{
+		string err;
+		err += "[DeserializeCodeTable] Failed to open input stream";
+		err += "\nPath: ";
+		err += Path;
+		throw std::runtime_error(err);
+	}
+
+	stringstream sstr;
+	sstr << ifs.rdbuf();
+	ifs.close();
+
+	const string buf = sstr.str();
+	size_t pos = sizeof(CodeTableMagic) + 3;
+
+	if (buf.size() < pos || buf.compare(0, sizeof(CodeTableMagic), CodeTableMagic, sizeof(CodeTableMagic)) != 0)
+		throw std::runtime_error("[DeserializeCodeTable] Not a code table");
+
+	if ((unsigned char) buf[4] != CodeTableVersion)
+		throw std::runtime_error("[DeserializeCodeTable] Unsupported code table version");
+
+	const bool Explicit = (buf[5] & CodeTableExplicit) != 0;
+	const size_t nCodes = (unsigned char) buf[6] + 1;
+
+	CodeLengthMap lengths;
+	HuffCodeMap codes;
+
+	for (size_t i = 0; i < nCodes; i++)
+	{
+		if (pos + 2 > buf.size())
+			throw std::runtime_error("[DeserializeCodeTable] Truncated code table");
+
+		char symbol = buf[pos];
+		unsigned int nBits = (unsigned char) buf[pos + 1];
+		pos += 2;
+
+		if (nBits == 0 || nBits > 64)
+			throw std::runtime_error("[DeserializeCodeTable] Invalid code length");
+
+		if (!lengths.insert(CodeLengthMap::value_type(symbol, nBits)).second)
+			throw std::runtime_error("[DeserializeCodeTable] Repeated character");
+
+		if (Explicit)
+		{
+			if (pos + (nBits + 7) / 8 > buf.size())
+				throw std::runtime_error("[DeserializeCodeTable] Truncated code table");
+
+			HuffCode code(nBits);
+			for (unsigned int j = 0; j < nBits; j++)
+				code[j] = ((unsigned char) buf[pos + j / 8] >> (7 - j % 8)) & 1;
+
+			if (!codes.insert(HuffCodeMap::value_type(symbol, code)).second)
+				throw std::runtime_error("[DeserializeCodeTable] Repeated code");
+
+			pos += (nBits + 7) / 8;
+		}
+	}
+
+	if (pos != buf.size())
+		throw std::runtime_error("[DeserializeCodeTable] Trailing bytes after the code table");
+
+	if (!Explicit)
+		codes = HuffmanCoding::GenerateCanonicalCodes(lengths);
+	else if (!IsPrefixFree(codes))
+		throw std::runtime_error("[DeserializeCodeTable] Codes are not prefix-free");
+
+	return codes;
+}
+
+/**
+ * Converts a Huffman code from the boost archive into the compact binary
+ * format. The codes are kept as they are, unless a maximum code length is
+ * given; then they are replaced with canonical codes of limited length,
+ * which cannot decode data compressed with the original codes.
+ * @param LegacyPath Path to where the archived Huffman code mapping is stored.
+ * @param Path Path to where the binary code table is to be serialized.
+ * @param nMaxBits Maximum code length, or zero to keep the codes.
+ */
+void ConvertHuffmanCode(const string& LegacyPath, const string& Path, unsigned int nMaxBits)
+{
+	HuffCodeMap codes = DeserializeHuffmanCode(LegacyPath);
+
+	if (nMaxBits != 0)
+	{
+		CodeLengthMap lengths = HuffmanCoding::GetCodeLengths(codes);
+		HuffmanCoding::LimitCodeLengths(lengths, nMaxBits);
+		codes = HuffmanCoding::GenerateCanonicalCodes(lengths);
+	}
+
+	SerializeCodeTable(codes, Path);
+}
+
+/* Leading bytes and version of binary frequency tables */
+static const char FrequencyTableMagic[4] = {'B', 'M', 'S', 'F'};
+static const char ContextTableMagic[4] = {'B', 'M', 'S', 'C'};
+static const unsigned char FrequencyTableVersion = 1;
+
+/**
+ * Appends a frequency distribution to a buffer as the number of characters
+ * less one, followed by every character and its frequency as a big-endian
+ * 32-bit integer, in ascending byte order.
+ * @param buf Buffer to be appended to.
+ * @param Frequencies To be appended frequency distribution.
+ */
+static void AppendFrequencies(string& buf, const FreqMap& Frequencies)
+{
+	if (Frequencies.empty() || Frequencies.size() > 256)
+		throw std::runtime_error("[SerializeFrequencies] Invalid number of characters");
+
+	map<unsigned char, int> ordered;
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->second < 0)
+			throw std::runtime_error("[SerializeFrequencies] Negative frequency");
+
+		ordered[(unsigned char) it->first] = it->second;
+	}
+
+	buf += (char) (ordered.size() - 1);
+
+	for (map<unsigned char, int>::const_iterator it = ordered.begin(); it != ordered.end(); it++)
+	{
+		buf += (char) it->first;
+		for (int i = 3; i >= 0; i--)
+			buf += (char) ((uint32_t) it->second >> (8 * i));
+	}
+}
+
+/**
+ * Reads a frequency distribution appended by AppendFrequencies.
+ * @param Buf Buffer holding the distribution.
+ * @param pos Position of the distribution, advanced behind it.
+ * @result The stored frequency distribution.
+ */
+static FreqMap ReadFrequencies(const string& Buf, size_t& pos)
+{
+	if (pos >= Buf.size())
+		throw std::runtime_error("[DeserializeFrequencies] Truncated frequency table");
+
+	const size_t nSymbols = (unsigned char) Buf[pos++] + 1;
+	if (Buf.size() - pos < 5 * nSymbols)
+		throw std::runtime_error("[DeserializeFrequencies] Truncated frequency table");
+
+	FreqMap frequencies;
+	for (size_t i = 0; i < nSymbols; i++, pos += 5)
+	{
+		uint32_t f = 0;
+		for (int j = 1; j <= 4; j++)
+			f = (f << 8) | (unsigned char) Buf[pos + j];
+
+		frequencies[Buf[pos]] = (int) f;
+	}
+
+	return frequencies;
+}
+
+/**
+ * Writes a binary table to a specified location.
+ * @param Buf Contents of the table.
+ * @param Path Path to where the table is to be written.
+ */
+static void WriteTable(const string& Buf, const string& Path)
+{
+	fs::ofstream ofs(Path, std::ios::binary);
+	if (!ofs.good())
+	{
+		string err;
+		err += "[SerializeFrequencies] Failed to open output stream";
+		err += "\nPath: ";
+		err += Path;
+		throw std::runtime_error(err);
+	}
+
+	ofs.write(Buf.data(), Buf.size());
+	ofs.close();
+}
+
+/**
+ * Reads a binary table from a specified location and checks its leading bytes and version.
+ * @param Path Path to where the table is stored.
+ * @param Magic Expected leading bytes.
+ * @result Contents of the table.
+ */
+static string ReadTable(const string& Path, const char (&Magic)[4])
+{
+	fs::ifstream ifs(Path, std::ios::binary);
+	if (!ifs.good())
+	{
+		string err;
+		err += "[DeserializeFrequencies] Failed to open input stream";
+		err += "\nPath: ";
+		err += Path;
+		throw std::runtime_error(err);
+	}
+
+	stringstream sstr;
+	sstr << ifs.rdbuf();
+	ifs.close();
+
+	const string buf = sstr.str();
+
+	if (buf.size() < sizeof(Magic) + 1 || buf.compare(0, sizeof(Magic), Magic, sizeof(Magic)) != 0)
+		throw std::runtime_error("[DeserializeFrequencies] Not a frequency table");
+
+	if ((unsigned char) buf[sizeof(Magic)] != FrequencyTableVersion)
+		throw std::runtime_error("[DeserializeFrequencies] Unsupported frequency table version");
+
+	return buf;
+}
+
+/**
+ * Serializes a frequency distribution to a specified location in a compact
+ * binary format. It starts with the bytes "BMSF" and a version byte,
+ * followed by the number of characters less one and every character with
+ * its frequency as a big-endian 32-bit integer, in ascending byte order.
+ * @param Frequencies To be serialized frequency distribution.
+ * @param Path Path to where the distribution is to be serialized.
+ */
+void SerializeFrequencies(const FreqMap& Frequencies, const string& Path)
+{
+	string buf(FrequencyTableMagic, sizeof(FrequencyTableMagic));
+	buf += (char) FrequencyTableVersion;
+	AppendFrequencies(buf, Frequencies);
+
+	WriteTable(buf, Path);
+}
+
+/**
+ * Deserializes a frequency distribution in the compact binary format from a specified location.
+ * @param Path Path to where the distribution is stored.
+ * @result The stored frequency distribution.
+ */
+FreqMap DeserializeFrequencies(const string& Path)
+{
+	const string buf = ReadTable(Path, FrequencyTableMagic);
+	size_t pos = sizeof(FrequencyTableMagic) + 1;
+
+	return ReadFrequencies(buf, pos);
+}
+
+/**
+ * Serializes frequency distributions by preceding character to a specified
+ * location. The format starts with the bytes "BMSC", a version byte and
+ * the number of contexts less one, followed by every context character
+ * and its distribution as in the format of SerializeFrequencies.
+ * @param Frequencies To be serialized frequency distributions.
+ * @param Path Path to where the distributions are to be serialized.
+ */
+void SerializeContextFrequencies(const ContextFreqMap& Frequencies, const string& Path)
+{
+	if (Frequencies.empty() || Frequencies.size() > 256)
+		throw std::runtime_error("[SerializeContextFrequencies] Invalid number of contexts");
+
+	string buf(ContextTableMagic, sizeof(ContextTableMagic));
+	buf += (char) FrequencyTableVersion;
+	buf += (char) (Frequencies.size() - 1);
+
+	for (ContextFreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		buf += it->first;
+		AppendFrequencies(buf, it->second);
+	}
+
+	WriteTable(buf, Path);
+}
+
+/**
+ * Deserializes frequency distributions by preceding character from a specified location.
+ * @param Path Path to where the distributions are stored.
+ * @result The stored frequency distributions.
+ */
+ContextFreqMap DeserializeContextFrequencies(const string& Path)
+{
+	const string buf = ReadTable(Path, ContextTableMagic);
+	size_t pos = sizeof(ContextTableMagic) + 1;
+
+	if (pos >= buf.size())
+		throw std::runtime_error("[DeserializeContextFrequencies] Truncated frequency table");
+
+	const size_t nContexts = (unsigned char) buf[pos++] + 1;
+
+	ContextFreqMap frequencies;
+	for (size_t i = 0; i < nContexts; i++)
+	{
+		if (pos >= buf.size())
+			throw std::runtime_error("[DeserializeContextFrequencies] Truncated frequency table");
+
+		const char context = buf[pos++];
+		frequencies[context] = ReadFrequencies(buf, pos);
+	}
+
+	return frequencies;
+}
+
 /**
  * Serializes a given keypair map to a specified location.
  * @param Keymap To be serialized keypair map.
@@ -113,7 +513,7 @@ void SerializeKeypairMap(const KeypairMap& Keymap, const string& Path)
     	throw std::runtime_error(err);
 	}
 
-	map<DataBits, vector<unsigned char>> tmpMap;
+	map<vector<bool>, vector<unsigned char>> tmpMap;
 	boost::archive::text_oarchive oa(ofs);
 
 	for (KeypairMap::const_iterator it = Keymap.begin(); it != Keymap.end(); it++)
@@ -125,7 +525,7 @@ void SerializeKeypairMap(const KeypairMap& Keymap, const string& Path)
 		element.insert(element.begin(), (unsigned char)compression);
 		element.insert(element.end(), key.begin(), key.end());
 
-		tmpMap[it->first] = element;
+		tmpMap[vector<bool>(it->first.begin(), it->first.end())] = element;
 	}
 
 	oa << tmpMap;
@@ -152,19 +552,20 @@ KeypairMap DeserializeKeypairMap(const string& Path)
 	KeypairMap keymap;
 	boost::archive::text_iarchive ia(ifs);
 
-	map<DataBits, vector<unsigned char>> tmpMap;
+	map<vector<bool>, vector<unsigned char>> tmpMap;
 	ia >> tmpMap;
 	ifs.close();
 
-	for (map<DataBits, vector<unsigned char>>::const_iterator it = tmpMap.begin(); it != tmpMap.end(); it++)
+	for (map<vector<bool>, vector<unsigned char>>::const_iterator it = tmpMap.begin(); it != tmpMap.end(); it++)
 	{
+		DataBits bits(it->first.begin(), it->first.end());
 		vector<unsigned char> element = it->second;
 
 		bool compression = (bool)element[0];
 		vector<unsigned char> key = vector<unsigned char>(element.begin()+1, element.end());
 
-		keymap[it->first] = CKey();
-		keymap[it->first].Set(key.begin(), key.end(), compression);
+		keymap[bits] = CKey();
+		keymap[bits].Set(key.begin(), key.end(), compression);
 	}
 
 	return keymap;
@@ -18,6 +18,15 @@ namespace Serialization
 	void SerializeHuffmanCode(const HuffCodeMap& Code, const std::string& Path);
 	HuffCodeMap DeserializeHuffmanCode(const std::string& Path);
 
+	void SerializeCodeTable(const HuffCodeMap& Codes, const std::string& Path);
+	HuffCodeMap DeserializeCodeTable(const std::string& Path);
+	void ConvertHuffmanCode(const std::string& LegacyPath, const std::string& Path, unsigned int nMaxBits = 0);
+
+	void SerializeFrequencies(const FreqMap& Frequencies, const std::string& Path);
+	FreqMap DeserializeFrequencies(const std::string& Path);
+	void SerializeContextFrequencies(const ContextFreqMap& Frequencies, const std::string& Path);
+	ContextFreqMap DeserializeContextFrequencies(const std::string& Path);
+
 	void SerializeKeypairMap(const KeypairMap& Keymap, const std::string& Path);
 	KeypairMap DeserializeKeypairMap(const std::string& Path);
 
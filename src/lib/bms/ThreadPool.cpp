@@ -0,0 +1,134 @@
+/**
+ * ThreadPool.cpp
+ *
+ * Fixed set of worker threads running batches of indexed jobs.
+ * The calling thread takes part in every batch and returns once
+ * all jobs of the batch are finished, so results written per job
+ * index come out in a deterministic order.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+
+/**
+ * Starts the worker threads.
+ * @param nThreads Number of threads including the calling one, or zero for one per core.
+ */
+ThreadPool::ThreadPool(unsigned int nThreads) :
+		pJob(NULL), nJobs(0), nNext(0), nFinished(0), nGeneration(0), bStop(false)
+{
+	if (nThreads == 0)
+		nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 1; i < nThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::Work, this));
+}
+
+/** Stops and joins the worker threads. */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		bStop = true;
+	}
+	wake.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+/**
+ * Returns the thread pool shared by the library, with one thread per core.
+ * @result The shared thread pool.
+ */
+ThreadPool& ThreadPool::Default()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+/**
+ * Runs the jobs 0 to \p nJobs - 1 on all threads and waits for them to finish.
+ * Must not be called from within a job. The first exception thrown by a job
+ * is rethrown once all jobs are finished.
+ * @param nJobs Number of jobs.
+ * @param job Function called with the index of each job.
+ */
+void ThreadPool::Run(size_t nJobs, const Job& job)
+{
+	if (nJobs == 0)
+		return;
+
+	std::lock_guard<std::mutex> runGuard(runLock);
+	std::unique_lock<std::mutex> guard(lock);
+
+	this->pJob = &job;
+	this->nJobs = nJobs;
+	this->nNext = 0;
+	this->nFinished = 0;
+	this->error = std::exception_ptr();
+	this->nGeneration++;
+
+	wake.notify_all();
+
+	RunJobs(guard);
+	done.wait(guard, [this]{ return this->nFinished == this->nJobs; });
+
+	std::exception_ptr e = this->error;
+	this->error = std::exception_ptr();
+	this->pJob = NULL;
+
+	guard.unlock();
+
+	if (e)
+		std::rethrow_exception(e);
+}
+
+/** Waits for batches and takes part in them until the pool is stopped. */
+void ThreadPool::Work()
+{
+	uint64_t nSeen = 0;
+	std::unique_lock<std::mutex> guard(lock);
+
+	while (true)
+	{
+		wake.wait(guard, [&]{ return bStop || nGeneration != nSeen; });
+		if (bStop)
+			return;
+
+		nSeen = nGeneration;
+		RunJobs(guard);
+	}
+}
+
+/** Takes jobs of the current batch until none are left. */
+void ThreadPool::RunJobs(std::unique_lock<std::mutex>& guard)
+{
+	while (pJob != NULL && nNext < nJobs)
+	{
+		const Job& job = *pJob;
+		const size_t i = nNext++;
+
+		guard.unlock();
+		try
+		{
+			job(i);
+		}
+		catch (...)
+		{
+			guard.lock();
+			if (!error)
+				error = std::current_exception();
+			guard.unlock();
+		}
+		guard.lock();
+
+		if (++nFinished == nJobs)
+			done.notify_all();
+	}
+}
@@ -0,0 +1,64 @@
+/**
+ * ThreadPool.h
+ *
+ * Fixed set of worker threads running batches of indexed jobs.
+ * The calling thread takes part in every batch and returns once
+ * all jobs of the batch are finished, so results written per job
+ * index come out in a deterministic order.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_THREADPOOL_H
+#define BMS_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	typedef std::function<void(size_t)> Job;
+
+	/* === Constructors === */
+	explicit ThreadPool(unsigned int nThreads = 0);
+	~ThreadPool();
+
+	static ThreadPool& Default();
+
+	/* === Capacity === */
+	unsigned int size() const { return workers.size() + 1; }
+
+	/* === Execution === */
+	void Run(size_t nJobs, const Job& job);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex runLock;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const Job* pJob;
+	size_t nJobs;
+	size_t nNext;
+	size_t nFinished;
+	uint64_t nGeneration;
+	bool bStop;
+	std::exception_ptr error;
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void Work();
+	void RunJobs(std::unique_lock<std::mutex>& guard);
+};
+
+#endif
@@ -0,0 +1,370 @@
+/**
+ * Training.cpp
+ *
+ * Module for training compression tables on a corpus of text
+ * files. The files are counted in parallel, each memory-mapped
+ * only while its chunks are counted, both by character and by
+ * preceding character. The counts are restricted to the alphabet
+ * of the compressor and can be turned into any of its tables.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include "Training.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+
+using std::string;
+using std::vector;
+
+namespace fs = boost::filesystem;
+
+namespace Training
+{
+
+/** Read-only memory mapping of a whole file. */
+class MappedFile
+{
+public:
+	explicit MappedFile(const string& Path) : pData(NULL), nSize(0)
+	{
+		int fd = open(Path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("[MappedFile] Failed to open file\nPath: " + Path);
+
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			throw std::runtime_error("[MappedFile] Failed to query file size\nPath: " + Path);
+		}
+
+		nSize = st.st_size;
+		if (nSize > 0)
+		{
+			void* p = mmap(NULL, nSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+			{
+				close(fd);
+				throw std::runtime_error("[MappedFile] Failed to map file\nPath: " + Path);
+			}
+
+			madvise(p, nSize, MADV_SEQUENTIAL);
+			pData = (const char*) p;
+		}
+
+		close(fd);
+	}
+
+	~MappedFile()
+	{
+		if (pData != NULL)
+			munmap((void*) pData, nSize);
+	}
+
+	const char* data() const { return pData; }
+	size_t size() const { return nSize; }
+
+private:
+	const char* pData;
+	size_t nSize;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+/**
+ * Lists the regular files within a directory and its subdirectories.
+ * @param Directory Path to the corpus directory.
+ * @result Paths of the files in ascending order.
+ */
+vector<string> ListCorpus(const string& Directory)
+{
+	if (!fs::is_directory(Directory))
+		throw std::runtime_error("[ListCorpus] Not a directory\nPath: " + Directory);
+
+	vector<string> paths;
+	for (fs::recursive_directory_iterator it(Directory), end; it != end; it++)
+	{
+		if (fs::is_regular_file(it->status()))
+			paths.push_back(it->path().string());
+	}
+
+	std::sort(paths.begin(), paths.end());
+
+	return paths;
+}
+
+/**
+ * Adds the successions of characters within a chunk of a file to histograms
+ * by preceding character. Bytes outside the restricted alphabet are
+ * skipped, as they are removed before compression, and every file is
+ * taken to be preceded and followed by the end-of-file character.
+ * @param contexts Histograms by preceding character to be added to.
+ * @param pFile Contents of the file.
+ * @param nBegin Position of the chunk within the file.
+ * @param nEnd End of the chunk within the file.
+ * @param bLast Whether the chunk ends the file.
+ */
+static void AccumulateContexts(vector<Histogram>& contexts, const char* pFile, size_t nBegin, size_t nEnd, bool bLast)
+{
+	const unsigned char* p = (const unsigned char*) pFile;
+
+	bool valid[256];
+	for (int c = 0; c < 256; c++)
+		valid[c] = !HuffmanCoding::IsCharInvalid((char) c);
+
+	/* The preceding character lies in an earlier chunk */
+	unsigned char context = (unsigned char) EoF;
+	for (size_t i = nBegin; i > 0; i--)
+	{
+		if (valid[p[i - 1]])
+		{
+			context = p[i - 1];
+			break;
+		}
+	}
+
+	for (size_t i = nBegin; i < nEnd; i++)
+	{
+		if (!valid[p[i]])
+			continue;
+
+		contexts[context][p[i]]++;
+		context = p[i];
+	}
+
+	if (bLast)
+		contexts[context][(unsigned char) EoF]++;
+}
+
+/**
+ * Counts the characters of a corpus, both on their own and by their
+ * preceding character. The files are split into chunks, which every thread
+ * of the pool takes one after another into histograms of its own. A file
+ * is mapped into memory by the first job counting one of its chunks and
+ * unmapped once all of its chunks are counted, so that only the files
+ * currently counted are mapped. The histograms are summed once all chunks
+ * are counted.
+ * @param Paths Paths of the corpus files.
+ * @param pool Threads that count the chunks.
+ * @param nChunkSize Number of bytes counted per job.
+ * @result Number of occurrences of every byte and of every succession of
+ *         characters in the corpus.
+ */
+CorpusCounts CountCorpus(const vector<string>& Paths, ThreadPool& pool, size_t nChunkSize)
+{
+	if (nChunkSize == 0)
+		throw std::runtime_error("[CountCorpus] Invalid chunk size");
+
+	/* Mapping of a file, shared by the jobs counting its chunks */
+	struct OpenFile
+	{
+		std::mutex lock;
+		std::shared_ptr<const MappedFile> mapping;
+		size_t nPending;
+	};
+
+	struct Chunk
+	{
+		size_t file;
+		size_t pos;
+		bool bLast;
+	};
+
+	Histogram zero;
+	zero.fill(0);
+
+	CorpusCounts result;
+	result.counts = zero;
+	result.contexts.assign(256, zero);
+	result.nFiles = Paths.size();
+	result.nBytes = 0;
+
+	/* Every file has at least one chunk, so that empty files end a message as well */
+	vector<OpenFile> files(Paths.size());
+	vector<Chunk> chunks;
+
+	for (size_t i = 0; i < Paths.size(); i++)
+	{
+		const size_t nSize = fs::file_size(Paths[i]);
+		const size_t nChunks = std::max<size_t>((nSize + nChunkSize - 1) / nChunkSize, 1);
+
+		for (size_t j = 0; j < nChunks; j++)
+		{
+			Chunk chunk = {i, j * nChunkSize, j + 1 == nChunks};
+			chunks.push_back(chunk);
+		}
+
+		files[i].nPending = nChunks;
+	}
+
+	std::atomic<size_t> nNext(0);
+	std::mutex lock;
+
+	pool.Run(pool.size(), [&](size_t) {
+		Histogram counts = zero;
+		vector<Histogram> contexts(256, zero);
+		uint64_t nBytes = 0;
+
+		for (size_t i = nNext++; i < chunks.size(); i = nNext++)
+		{
+			const Chunk& chunk = chunks[i];
+			OpenFile& open = files[chunk.file];
+
+			std::shared_ptr<const MappedFile> file;
+			{
+				std::lock_guard<std::mutex> guard(open.lock);
+				if (!open.mapping)
+				{
+					try
+					{
+						open.mapping = std::make_shared<MappedFile>(Paths[chunk.file]);
+					}
+					catch (...)
+					{
+						/* Leave the remaining chunks to no one */
+						nNext = chunks.size();
+						throw;
+					}
+				}
+				file = open.mapping;
+			}
+
+			/* The last chunk takes whatever the file has grown by since listing */
+			const size_t nBegin = std::min(chunk.pos, file->size());
+			const size_t nEnd = chunk.bLast ? file->size() : std::min(chunk.pos + nChunkSize, file->size());
+
+			HuffmanCoding::AccumulateHistogram(counts, file->data() + nBegin, nEnd - nBegin);
+			AccumulateContexts(contexts, file->data(), nBegin, nEnd, chunk.bLast);
+			nBytes += nEnd - nBegin;
+
+			std::lock_guard<std::mutex> guard(open.lock);
+			if (--open.nPending == 0)
+				open.mapping.reset();
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+		for (int c = 0; c < 256; c++)
+		{
+			result.counts[c] += counts[c];
+			for (int d = 0; d < 256; d++)
+				result.contexts[c][d] += contexts[c][d];
+		}
+		result.nBytes += nBytes;
+	});
+
+	return result;
+}
+
+/**
+ * Computes the frequency distribution a compressor sees for a corpus. Bytes
+ * outside the restricted alphabet are dropped, as they are removed before
+ * compression, and every file counts as one message ending with the
+ * end-of-file character.
+ * @param Counts Counts of the corpus.
+ * @result Frequency distribution of characters.
+ */
+FreqMap CorpusFrequencies(const CorpusCounts& Counts)
+{
+	Histogram counts = Counts.counts;
+
+	for (int c = 0; c < 256; c++)
+	{
+		if (HuffmanCoding::IsCharInvalid((char) c))
+			counts[c] = 0;
+	}
+
+	counts[(unsigned char) EoF] = std::max<size_t>(Counts.nFiles, 1);
+
+	return HuffmanCoding::ComputeFrequencies(counts);
+}
+
+/**
+ * Computes the frequency distributions an order-1 context model sees for a
+ * corpus, by preceding character. Counts too large for a frequency are
+ * scaled down per preceding character.
+ * @param Counts Counts of the corpus.
+ * @result Frequency distributions of characters by their preceding character.
+ */
+ContextFreqMap CorpusContextFrequencies(const CorpusCounts& Counts)
+{
+	ContextFreqMap frequencies;
+
+	for (size_t c = 0; c < Counts.contexts.size(); c++)
+	{
+		const Histogram& counts = Counts.contexts[c];
+		if (*std::max_element(counts.begin(), counts.end()) != 0)
+			frequencies[(char) c] = HuffmanCoding::ComputeFrequencies(counts);
+	}
+
+	return frequencies;
+}
+
+/**
+ * Computes the entropy of a frequency distribution, the least number of
+ * bits per character any coder can achieve. The end-of-file character is
+ * left out.
+ * @param Frequencies Frequency distribution of characters.
+ * @result Entropy in bits per character.
+ */
+double Entropy(const FreqMap& Frequencies)
+{
+	double nTotal = 0, sum = 0;
+
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->first != EoF && it->second > 0)
+			nTotal += it->second;
+	}
+
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->first != EoF && it->second > 0)
+			sum -= it->second * std::log2(it->second / nTotal);
+	}
+
+	return nTotal > 0 ? sum / nTotal : 0;
+}
+
+/**
+ * Computes the average code length of a Huffman coding on a frequency
+ * distribution. The end-of-file character is left out.
+ * @param Frequencies Frequency distribution of characters.
+ * @param Lengths Code lengths of characters.
+ * @result Expected number of bits per character.
+ */
+double BitsPerChar(const FreqMap& Frequencies, const CodeLengthMap& Lengths)
+{
+	double nTotal = 0, nBits = 0;
+
+	for (FreqMap::const_iterator it = Frequencies.begin(); it != Frequencies.end(); it++)
+	{
+		if (it->first == EoF || it->second <= 0)
+			continue;
+
+		CodeLengthMap::const_iterator code = Lengths.find(it->first);
+		if (code == Lengths.end())
+			throw std::out_of_range("[BitsPerChar] Character has no code");
+
+		nTotal += it->second;
+		nBits += (double) it->second * code->second;
+	}
+
+	return nTotal > 0 ? nBits / nTotal : 0;
+}
+
+}
@@ -0,0 +1,44 @@
+/**
+ * Training.h
+ *
+ * Module for training compression tables on a corpus of text
+ * files. The files are counted in parallel, each memory-mapped
+ * only while its chunks are counted, both by character and by
+ * preceding character. The counts are restricted to the alphabet
+ * of the compressor and can be turned into any of its tables.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#ifndef BMS_TRAINING_H
+#define BMS_TRAINING_H
+
+#include "DataCompression.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <vector>
+
+namespace Training
+{
+	/* Number of bytes counted per job */
+	const size_t ChunkSize = 16 << 20;
+
+	struct CorpusCounts{
+		Histogram counts;
+		std::vector<Histogram> contexts;
+		size_t nFiles;
+		uint64_t nBytes;
+	};
+
+	std::vector<std::string> ListCorpus(const std::string& Directory);
+	CorpusCounts CountCorpus(const std::vector<std::string>& Paths, ThreadPool& pool, size_t nChunkSize = ChunkSize);
+	FreqMap CorpusFrequencies(const CorpusCounts& Counts);
+	ContextFreqMap CorpusContextFrequencies(const CorpusCounts& Counts);
+
+	double Entropy(const FreqMap& Frequencies);
+	double BitsPerChar(const FreqMap& Frequencies, const CodeLengthMap& Lengths);
+};
+
+#endif
@@ -9,10 +9,12 @@
  */
 
 #include "Types.h"
+#include "BitKernels.h"
 #include "util.h"
 
 #include <stdlib.h>
 #include <iostream>
+#include <iterator>
 #include <random>
 
 using std::string;
@@ -27,7 +29,7 @@ using std::stringstream;
  */
 void PadBits(DataBits& bits, uint32_t nBits)
 {
-	bits.insert(bits.end(), nBits, false);
+	bits.Pad(nBits);
 }
 
 /**
@@ -37,10 +39,7 @@ void PadBits(DataBits& bits, uint32_t nBits)
  */
 DataBits SliceBits(DataBits& bits, uint32_t nBits)
 {
-	DataBits slice = DataBits(bits.begin(), bits.begin()+nBits);
-	bits.erase(bits.begin(), bits.begin()+nBits);
-
-	return slice;
+	return bits.Slice(nBits);
 }
 
 
@@ -53,12 +52,15 @@ char BoolVecToChar(const vector<bool>& Vec)
 {
 	assert(Vec.size() == 8);
 
-	char c = 0x00;
+	unsigned char bytes[8];
 	for (unsigned int i = 0; i < 8; i++)
 	{
-		c += (Vec[i] << (7 - i));
+		bytes[i] = Vec[i];
 	}
 
+	unsigned char c;
+	BitKernels::CompactBits(bytes, 1, &c);
+
 	return c;
 }
 
@@ -69,13 +71,10 @@ char BoolVecToChar(const vector<bool>& Vec)
  */
 vector<bool> CharToBoolVec(char ch)
 {
-	vector<bool> vec;
-	for (unsigned int i = 0; i < 8; i++)
-	{
-		vec.push_back((ch >> (7 - i)) & 0x01);
-	}
+	unsigned char bytes[8];
+	BitKernels::ExpandBits((const unsigned char*) &ch, 1, bytes);
 
-	return vec;
+	return vector<bool>(bytes, bytes + 8);
 }
 
 /**
@@ -85,14 +84,11 @@ vector<bool> CharToBoolVec(char ch)
  */
 DataBits DataToBits(const Data& data)
 {
-	DataBits vec, tmp;
-	for(Data::const_iterator it = data.begin(); it != data.end(); it++)
-	{
-		tmp = CharToBoolVec(*it);
-		vec.insert(vec.end(), tmp.begin(), tmp.end());
-	}
+	DataBits bits;
+	if (!data.empty())
+		bits.AppendBytes(&data[0], data.size());
 
-	return vec;
+	return bits;
 }
 
 /**
@@ -100,20 +96,13 @@ DataBits DataToBits(const Data& data)
  * @param data Binary vector to be converted.
  * @result Converted unsigned char vector.
  */
-Data BitsToData(const DataBits& data)
+Data BitsToData(const BitView& data)
 {
 	assert(data.size() % 8 == 0);
 
-	Data buf;
-	DataBits slice;
-	unsigned char tmp;
-
-	for(unsigned int i = 0; i < data.size(); i+=8)
-	{
-		slice = DataBits(data.begin()+i, data.begin()+i+8);
-		tmp = BoolVecToChar(slice);
-		buf.push_back(tmp);
-	}
+	Data buf(data.size() / 8);
+	if (!buf.empty())
+		data.CopyBytes(&buf[0]);
 
 	return buf;
 }
@@ -123,16 +112,21 @@ Data BitsToData(const DataBits& data)
  * @param data Binary vector to be converted.
  * @result Converted integer.
  */
-BigInt DataBitsToInt(const DataBits& data)
+BigInt DataBitsToInt(const BitView& data)
 {
-	BigInt num = 0;
+	/* Right-align the bits so that only the leading word is partial */
+	const size_t nLead = data.size() % BitView::WordBits;
 
-	for(unsigned int i = 0; i < data.size()-1; i++)
-	{
-		num += data[i] & 0x01;
-		num *= 2;
-	}
-	num += data[data.size()-1] & 0x01;
+	vector<uint64_t> words;
+	words.reserve(data.size() / BitView::WordBits + 1);
+
+	if (nLead != 0)
+		words.push_back(data.Peek(0, nLead));
+	for (size_t i = nLead; i < data.size(); i += BitView::WordBits)
+		words.push_back(data.Peek(i, BitView::WordBits));
+
+	BigInt num = 0;
+	boost::multiprecision::import_bits(num, words.begin(), words.end(), BitView::WordBits);
 
 	return num;
 }
@@ -142,15 +136,19 @@ BigInt DataBitsToInt(const DataBits& data)
  * @param num Integer to be converted.
  * @result Converted binary vector.
  */
-DataBits IntToDataBits(BigInt num)
+DataBits IntToDataBits(const BigInt& num)
 {
 	DataBits dataBits;
+	if (num == 0)
+		return dataBits;
 
-	while(num != 0)
-	{
-		dataBits.insert(dataBits.begin(), (bool)(num & 0x01));
-		num /= 2;
-	}
+	vector<uint64_t> words;
+	boost::multiprecision::export_bits(num, std::back_inserter(words), BitView::WordBits);
+
+	dataBits.reserve(BitView::WordBits * words.size());
+	dataBits.Append(words[0], boost::multiprecision::msb(num) % BitView::WordBits + 1);
+	for (size_t i = 1; i < words.size(); i++)
+		dataBits.Append(words[i], BitView::WordBits);
 
 	return dataBits;
 }
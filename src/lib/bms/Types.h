@@ -15,6 +15,7 @@
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/multiprecision/cpp_dec_float.hpp>
 
+#include "BitBuffer.h"
 #include "base58.h"
 #include "core.h"
 #include "key.h"
@@ -22,7 +23,7 @@
 
 typedef std::vector<CTransaction> TransactionChain;
 typedef std::vector<unsigned char> Data;
-typedef std::vector<bool> DataBits;
+typedef BitBuffer DataBits;
 typedef boost::multiprecision::cpp_int BigInt;
 typedef boost::multiprecision::cpp_dec_float_100 BigFloat;
 
@@ -34,9 +35,9 @@ char BoolVecToChar(const std::vector<bool>& Vec);
 std::vector<bool> CharToBoolVec(char ch);
 
 DataBits DataToBits(const Data& Data);
-Data BitsToData(const DataBits& Data);
+Data BitsToData(const BitView& Data);
 
-BigInt DataBitsToInt(const DataBits& Data);
-DataBits IntToDataBits(BigInt num);
+BigInt DataBitsToInt(const BitView& Data);
+DataBits IntToDataBits(const BigInt& num);
 
 #endif
@@ -10,14 +10,16 @@
 
 #include "Utilities.h"
 #include "BlockchainInterface.h"
+#include "Random.h"
 #include "Serialization.h"
 
 #include <stdlib.h>
 #include <iostream>
+#include <sstream>
 #include <string>
-#include <random>
 
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 using std::string;
 using std::vector;
@@ -69,13 +71,24 @@ void LoadConfigFile()
 	Config = Serialization::DeserializeConfigMap(GetConfigPath() + "bms.conf");
 }
 
-/** Loads the Huffman code file with code mappings. */
+/**
+ * Loads the Huffman code file with code mappings, preferring the
+ * binary code table over the archived mapping. Without either file
+ * in the configuration directory the compiled-in code is used.
+ */
 void LoadHuffmanCode()
 {
 	if(IsHuffmanCodeLoaded())
 		return;
 
-	HuffCode = Serialization::DeserializeHuffmanCode(GetConfigPath() + "huffcode.map");
+	if(fs::exists(GetConfigPath() + "huffcode.bin"))
+	{
+		HuffCode = Serialization::DeserializeCodeTable(GetConfigPath() + "huffcode.bin");
+	}else if(fs::exists(GetConfigPath() + "huffcode.map")){
+		HuffCode = Serialization::DeserializeHuffmanCode(GetConfigPath() + "huffcode.map");
+	}else{
+		HuffCode = HuffmanCoding::DefaultCode();
+	}
 }
 
 /** Loads the keypair map file with private keys for signing transactions. */
@@ -247,6 +260,205 @@ void UnloadWallet()
 	Wallet = BitcoinAPI();
 }
 
+/**
+ * Creates the available compression backends, i.e. Huffman coding with the
+ * loaded code, rANS as well as order-1 context rANS if their trained
+ * frequency tables are present, Huffman coding behind references into
+ * the preset dictionary if it is present, and Huffman coding with the best
+ * of the loaded code and the numbered codes huffcode.<id>.bin per message.
+ * The dictionary is indexed here.
+ * @return The available backends.
+ */
+BackendList LoadCompressionBackends()
+{
+	BackendList backends;
+
+	/* The compiled-in code comes with its tables built */
+	std::shared_ptr<const HuffmanBackend> huffman;
+	if(HuffCode == HuffmanCoding::DefaultCode())
+		huffman = std::make_shared<HuffmanBackend>(HuffmanCoding::DefaultEncoder(), HuffmanCoding::DefaultDecoder());
+	else
+		huffman = std::make_shared<HuffmanBackend>(HuffCode);
+	backends.push_back(huffman);
+
+	if(fs::exists(GetConfigPath() + "rans.freq"))
+	{
+		FreqMap frequencies = Serialization::DeserializeFrequencies(GetConfigPath() + "rans.freq");
+		backends.push_back(std::make_shared<RansBackend>(frequencies));
+	}
+
+	if(fs::exists(GetConfigPath() + "context.freq"))
+	{
+		ContextFreqMap frequencies = Serialization::DeserializeContextFrequencies(GetConfigPath() + "context.freq");
+		backends.push_back(std::make_shared<ContextBackend>(frequencies));
+	}
+
+	if(fs::exists(GetConfigPath() + "dictionary.txt"))
+	{
+		std::stringstream sstr;
+		fs::ifstream fileStream(GetConfigPath() + "dictionary.txt", std::ios::in | std::ios::binary);
+		sstr << fileStream.rdbuf();
+
+		string dictionary = sstr.str();
+		HuffmanCoding::TransformCharDomain(dictionary);
+		backends.push_back(std::make_shared<DictionaryBackend>(dictionary, backends.front()));
+	}
+
+	/* The loaded code has id 0, further codes are numbered in their file names */
+	vector<std::shared_ptr<const HuffmanBackend> > tables(1, huffman);
+	for(unsigned int id = 1; id < (1u << MultiTableBackend::TableBits); id++)
+	{
+		string path = GetConfigPath() + "huffcode." + std::to_string(id) + ".bin";
+		if(fs::exists(path))
+		{
+			tables.resize(id + 1);
+			tables[id] = std::make_shared<HuffmanBackend>(Serialization::DeserializeCodeTable(path));
+		}
+	}
+	backends.push_back(std::make_shared<MultiTableBackend>(tables));
+
+	return backends;
+}
+
+/**
+ * Returns the compression backend named in the configuration. Messages
+ * of the legacy setting are Huffman coded without a backend header.
+ * @param bFramed Set to whether messages carry a backend header.
+ * @return Id of the configured backend.
+ */
+static BackendId ConfiguredBackend(bool& bFramed)
+{
+	string name = Config.count("Compression.Backend") ? Config.at("Compression.Backend") : "legacy";
+
+	bFramed = (name != "legacy");
+
+	if(name == "legacy" || name == "huffman")
+		return BACKEND_HUFFMAN;
+	else if(name == "rans")
+		return BACKEND_RANS;
+	else if(name == "context")
+		return BACKEND_CONTEXT;
+	else if(name == "dictionary")
+		return BACKEND_DICTIONARY;
+	else if(name == "tables")
+		return BACKEND_TABLES;
+
+	throw std::runtime_error("[ConfiguredBackend] Unknown compression backend: " + name);
+}
+
+/**
+ * Compresses a message with the configured compression backend.
+ * @param Message To be compressed characters.
+ * @param Backends Available backends.
+ * @return Compressed message.
+ */
+DataBits CompressMessage(const Data& Message, const BackendList& Backends)
+{
+	bool bFramed;
+	const CompressionBackend& backend = Compression::FindBackend(Backends, ConfiguredBackend(bFramed));
+
+	return bFramed ? Compression::Compress(Message, backend) : backend.Compress(Message);
+}
+
+/**
+ * Returns whether read messages carry a backend header. This is set apart
+ * from the written backend, as messages are read that other installations
+ * wrote.
+ * @return Whether read messages are framed.
+ */
+static bool ReadsFramedMessages()
+{
+	string name = Config.count("Compression.Read") ? Config.at("Compression.Read") : "legacy";
+
+	if(name == "legacy")
+		return false;
+	else if(name == "framed")
+		return true;
+
+	throw std::runtime_error("[ReadsFramedMessages] Unknown message format: " + name);
+}
+
+/**
+ * Decompresses a message, with the backend named in its header unless the
+ * configuration reads legacy messages, which are Huffman coded.
+ * @param Bits Compressed message.
+ * @param Backends Available backends.
+ * @return Decompressed characters.
+ */
+Data DecompressMessage(const DataBits& Bits, const BackendList& Backends)
+{
+	if(ReadsFramedMessages())
+		return Compression::Decompress(Bits, Backends);
+
+	return Compression::FindBackend(Backends, BACKEND_HUFFMAN).Decompress(Bits);
+}
+
+/**
+ * Compresses a text file with the configured compression backend. The file
+ * is read in chunks that are filtered to the restricted alphabet in place.
+ * With Huffman coding every chunk is encoded right away, so the memory used
+ * does not grow with the file beyond its compressed size. Other backends
+ * code a message as a whole and get the filtered text at once.
+ * @param Path Path to the text file.
+ * @param Backends Available backends.
+ * @param echo Stream to which the filtered text is written.
+ * @return Compressed text and its number of characters.
+ */
+CompressedFile CompressFile(const string& Path, const BackendList& Backends, std::ostream& echo)
+{
+	fs::ifstream fileStream(Path, std::ios::in | std::ios::binary);
+	if(!fileStream.good())
+	{
+		string err;
+		err += "[CompressFile] Failed to open input stream";
+		err += "\nPath: ";
+		err += Path;
+		throw std::runtime_error(err);
+	}
+
+	bool bFramed;
+	const CompressionBackend& backend = Compression::FindBackend(Backends, ConfiguredBackend(bFramed));
+	const HuffmanBackend* pHuffman = dynamic_cast<const HuffmanBackend*>(&backend);
+
+	CompressedFile result;
+	result.nChars = 0;
+
+	if(bFramed)
+		result.bits.Append(backend.Id(), Compression::HeaderBits);
+
+	std::unique_ptr<HuffmanCoding::StreamEncoder> pStream;
+	if(pHuffman)
+		pStream.reset(new HuffmanCoding::StreamEncoder(pHuffman->GetEncoder(), result.bits));
+
+	const size_t ChunkSize = 1 << 16;
+	vector<char> chunk(ChunkSize);
+	Data text;
+
+	do
+	{
+		fileStream.read(chunk.data(), chunk.size());
+		size_t nChars = HuffmanCoding::FilterCharDomain(chunk.data(), fileStream.gcount());
+
+		echo.write(chunk.data(), nChars);
+		result.nChars += nChars;
+
+		if(pStream)
+			pStream->Write(chunk.data(), nChars);
+		else
+			text.insert(text.end(), chunk.begin(), chunk.begin() + nChars);
+	}while(fileStream);
+
+	if(fileStream.bad())
+		throw std::runtime_error("[CompressFile] Failed to read the file");
+
+	if(pStream)
+		pStream->Finish();
+	else
+		result.bits.Append(backend.Compress(text));
+
+	return result;
+}
+
 /**
  * Generates a random hex string of a specified length.
  * @param nChars Length of the hex string in characters.
@@ -255,16 +467,15 @@ void UnloadWallet()
 string GenerateRandomHexString(unsigned int nChars)
 {
 	const char Charset[] = "0123456789ABCDEF";
-	const size_t MaxIndex = (sizeof(Charset) - 2);
+	vector<unsigned char> bytes((nChars + 1) / 2);
 	string str;
+	str.reserve(nChars);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dist(0, MaxIndex);
+	Random::Fill(bytes.data(), bytes.size());
 
 	for (unsigned int i = 0; i < nChars; i++)
 	{
-		str += Charset[dist(gen)];
+		str += Charset[(i % 2 == 0) ? (bytes[i / 2] >> 4) : (bytes[i / 2] & 0x0F)];
 	}
 
 	return str;
@@ -277,15 +488,16 @@ string GenerateRandomHexString(unsigned int nChars)
  */
 DataBits GenerateRandomBits(unsigned int nBits)
 {
+	vector<unsigned char> bytes((nBits + 7) / 8);
 	DataBits data;
+	data.reserve(nBits);
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dist(0, 1);
+	Random::Fill(bytes.data(), bytes.size());
 
-	for (unsigned int i = 0; i < nBits; i++)
+	data.AppendBytes(bytes.data(), nBits / 8);
+	if (nBits % 8 != 0)
 	{
-		data.insert(data.end(), (bool)dist(gen));
+		data.Append(bytes.back() >> (8 - nBits % 8), nBits % 8);
 	}
 
 	return data;
@@ -303,7 +515,7 @@ KeypairMap GenerateKeypairMap(unsigned int nBits)
 	KeypairMap keyMap;
 	CPubKey pubkey;
 
-	DataBits key, buf;
+	DataBits key;
 	CKey val;
 
 	while (keyMap.size() < pow(2, nBits))
@@ -311,8 +523,8 @@ KeypairMap GenerateKeypairMap(unsigned int nBits)
 		val.MakeNewKey(true);
 		pubkey = val.GetPubKey();
 
-		buf = DataToBits(Data(pubkey.begin(), pubkey.end()));
-		key = DataBits(buf.end() - nBits, buf.end());
+		key = DataToBits(Data(pubkey.begin(), pubkey.end()));
+		key.Skip(key.size() - nBits);
 
 		keyMap[key] = val;
 	}
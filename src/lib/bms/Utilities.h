@@ -11,9 +11,11 @@
 #ifndef BMS_UTILITIES_H
 #define BMS_UTILITIES_H
 
+#include <ostream>
 #include <string>
 
 #include "BitcoinWallet.h"
+#include "CompressionBackend.h"
 #include "DataCompression.h"
 #include "Types.h"
 
@@ -23,6 +25,11 @@ typedef std::map<std::string, std::string> ConfigMap;
 
 namespace Utilities
 {
+	struct CompressedFile{
+		DataBits bits;
+		size_t nChars;
+	};
+
 	extern ConfigMap Config;
 	extern KeypairMap KeyMap;
 	extern KeyStore Store;
@@ -49,6 +56,11 @@ namespace Utilities
 	void UnloadKeystore();
 	void UnloadWallet();
 
+	BackendList LoadCompressionBackends();
+	DataBits CompressMessage(const Data& Message, const BackendList& Backends);
+	Data DecompressMessage(const DataBits& Bits, const BackendList& Backends);
+	CompressedFile CompressFile(const std::string& Path, const BackendList& Backends, std::ostream& echo);
+
 	std::string GenerateRandomHexString(unsigned int nChars);
 	DataBits GenerateRandomBits(unsigned int nBits);
 	KeypairMap GenerateKeypairMap(unsigned int nBits);
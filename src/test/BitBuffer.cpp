@@ -0,0 +1,99 @@
+/**
+ * BitBuffer.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "BitBuffer.h"
+#include "Utilities.h"
+
+
+BOOST_AUTO_TEST_SUITE(BitBufferTests)
+
+BOOST_AUTO_TEST_CASE(AppendAndRead)
+{
+	BitBuffer bits;
+
+	bits.Append(0x05, 3);
+	bits.Append(0x0123456789ABCDEF, 64);
+	bits.push_back(true);
+
+	BOOST_REQUIRE(bits.size() == 68);
+	BOOST_REQUIRE(bits.Read(3) == 0x05);
+	BOOST_REQUIRE(bits.Read(64) == 0x0123456789ABCDEF);
+	BOOST_REQUIRE(bits.Read(1) == 0x01);
+	BOOST_REQUIRE(bits.empty());
+}
+
+BOOST_AUTO_TEST_CASE(SlicingAgainstBoolVector)
+{
+	for(int i = 0; i < 1000; i++)
+	{
+		DataBits bits = Utilities::GenerateRandomBits(i);
+		std::vector<bool> vec(bits.begin(), bits.end());
+
+		unsigned int nBits = i / 3;
+		DataBits slice = bits.Slice(nBits);
+
+		BOOST_REQUIRE(slice == DataBits(vec.begin(), vec.begin() + nBits));
+		BOOST_REQUIRE(bits == DataBits(vec.begin() + nBits, vec.end()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(AppendByShift)
+{
+	for(int i = 0; i < 1000; i++)
+	{
+		DataBits first = Utilities::GenerateRandomBits(i % 130);
+		DataBits second = Utilities::GenerateRandomBits(i);
+
+		std::vector<bool> vec(first.begin(), first.end());
+		vec.insert(vec.end(), second.begin(), second.end());
+
+		first.Append(second);
+
+		BOOST_REQUIRE(first == DataBits(vec.begin(), vec.end()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ViewsAndSpans)
+{
+	for(int i = 0; i < 1000; i++)
+	{
+		DataBits bits = Utilities::GenerateRandomBits(i);
+		std::vector<bool> vec(bits.begin(), bits.end());
+
+		BitSpan::Word buf[20] = {0};
+		BitSpan span(buf, 1200);
+		span.Write(i % 64, bits);
+
+		BitView view = BitView(span).Sub(i % 64, i);
+		BOOST_REQUIRE(DataBits(view) == bits);
+
+		/* Bits behind the end of a view read as zero's */
+		DataBits padded(bits.View(0, i + 50));
+		vec.insert(vec.end(), 50, false);
+		BOOST_REQUIRE(padded == DataBits(vec.begin(), vec.end()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Ordering)
+{
+	DataBits a = {false, true};
+	DataBits b = {true};
+	DataBits c = {false, true, false};
+
+	BOOST_REQUIRE(a < b);
+	BOOST_REQUIRE(a < c);
+	BOOST_REQUIRE(!(b < a));
+	BOOST_REQUIRE(a != c);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
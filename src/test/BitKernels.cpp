@@ -0,0 +1,89 @@
+/**
+ * BitKernels.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "BitKernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace BitKernels;
+
+
+BOOST_AUTO_TEST_SUITE(BitKernelsTests)
+
+BOOST_AUTO_TEST_CASE(ImplementationsAgainstScalar)
+{
+	const Implementation Impls[] = {SSE2, AVX2, BMI2};
+	const Implementation Selected = GetImplementation();
+
+	for(unsigned int n = 0; n < 300; n++)
+	{
+		std::vector<unsigned char> bytes(n), bits(8 * n);
+		for(unsigned int i = 0; i < n; i++)
+			bytes[i] = rand() & 0xFF;
+		for(unsigned int i = 0; i < 8 * n; i++)
+			bits[i] = (rand() % 3 == 0) ? 0 : rand() & 0xFF;
+
+		SetImplementation(SCALAR);
+		std::vector<uint64_t> refWords((n + 7) / 8 + 1);
+		std::vector<unsigned char> refBytes(n + 1), refExpanded(8 * n + 1), refCompacted(n + 1);
+		PackBytes(bytes.data(), n, refWords.data());
+		UnpackWords(refWords.data(), n, refBytes.data());
+		ExpandBits(bytes.data(), n, refExpanded.data());
+		CompactBits(bits.data(), n, refCompacted.data());
+
+		BOOST_REQUIRE(std::equal(bytes.begin(), bytes.end(), refBytes.begin()));
+
+		for(unsigned int k = 0; k < sizeof(Impls) / sizeof(Impls[0]); k++)
+		{
+			if(!IsSupported(Impls[k]))
+				continue;
+
+			SetImplementation(Impls[k]);
+			BOOST_REQUIRE(GetImplementation() == Impls[k]);
+
+			std::vector<uint64_t> words(refWords.size());
+			std::vector<unsigned char> unpacked(n + 1), expanded(8 * n + 1), compacted(n + 1);
+			PackBytes(bytes.data(), n, words.data());
+			UnpackWords(words.data(), n, unpacked.data());
+			ExpandBits(bytes.data(), n, expanded.data());
+			CompactBits(bits.data(), n, compacted.data());
+
+			BOOST_REQUIRE(words == refWords);
+			BOOST_REQUIRE(unpacked == refBytes);
+			BOOST_REQUIRE(expanded == refExpanded);
+			BOOST_REQUIRE(compacted == refCompacted);
+		}
+	}
+
+	SetImplementation(Selected);
+}
+
+BOOST_AUTO_TEST_CASE(PackingIsMostSignificantFirst)
+{
+	const unsigned char bytes[10] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xF0, 0x0F};
+	uint64_t words[2];
+
+	PackBytes(bytes, 10, words);
+	BOOST_REQUIRE(words[0] == 0x0123456789ABCDEFULL);
+	BOOST_REQUIRE(words[1] == 0xF00F000000000000ULL);
+
+	unsigned char expanded[8];
+	ExpandBits(bytes + 1, 1, expanded);
+
+	const unsigned char expected[8] = {0, 0, 1, 0, 0, 0, 1, 1};
+	BOOST_REQUIRE(std::equal(expanded, expanded + 8, expected));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -42,7 +42,10 @@ BOOST_AUTO_TEST_CASE(PackIntoSequenceNr_Test)
 		CTxIn input = CTxIn();
 		PackDataIntoSeqNr(copy, input);
 
-		BOOST_REQUIRE(slice == UnpackDataFromSeqNr(input));
+		DataBits unpacked;
+		UnpackDataFromSeqNr(input, unpacked);
+
+		BOOST_REQUIRE(slice == unpacked);
 		BOOST_REQUIRE(bits == copy);
 	}
 }
@@ -60,7 +63,10 @@ BOOST_AUTO_TEST_CASE(PackIntoNulldata_Test)
 		CTxOut output = CTxOut();
 		PackDataIntoNulldata(copy, output);
 
-		BOOST_REQUIRE(slice == UnpackDataFromNulldata(output));
+		DataBits unpacked;
+		UnpackDataFromNulldata(output, unpacked);
+
+		BOOST_REQUIRE(slice == unpacked);
 		BOOST_REQUIRE(bits == copy);
 	}
 }
@@ -83,7 +89,10 @@ BOOST_AUTO_TEST_CASE(PackIntoBudgetSplit_Test)
 		std::vector<CTxOut> txOuts(nOuts);
 		PackDataIntoBudgetSplit(copy, txOuts, budget, lbound);
 
-		BOOST_REQUIRE(slice == UnpackDataFromBudgetSplit(txOuts, lbound));
+		DataBits unpacked;
+		UnpackDataFromBudgetSplit(txOuts, lbound, unpacked);
+
+		BOOST_REQUIRE(slice == unpacked);
 		BOOST_REQUIRE(bits == copy);
 	}
 }
@@ -104,7 +113,10 @@ BOOST_AUTO_TEST_CASE(PackIntoBudgetClaim_Test)
 
 		PackDataIntoBudgetClaim(copy, inputs);
 
-		BOOST_REQUIRE(slice == UnpackDataFromBudgetClaim(inputs));
+		DataBits unpacked;
+		UnpackDataFromBudgetClaim(inputs, unpacked);
+
+		BOOST_REQUIRE(slice == unpacked);
 		BOOST_REQUIRE(bits == copy);
 	}
 }
@@ -129,7 +141,10 @@ BOOST_AUTO_TEST_CASE(PackIntoP2SH_Test)
 
 		PackDataIntoP2SH(copy, txOut, tx, 0);
 
-		BOOST_REQUIRE(slice == UnpackDataFromP2SH(tx.vin[0]));
+		DataBits unpacked;
+		UnpackDataFromP2SH(tx.vin[0], unpacked);
+
+		BOOST_REQUIRE(slice == unpacked);
 		BOOST_REQUIRE(bits == copy);
 	}
 }
@@ -162,8 +177,7 @@ BOOST_AUTO_TEST_CASE(EmbeddingInTransactions_Test)
 		std::vector<CTransaction> txs = EmbedData(originalData, pow(10,7), prevOut, addr);
 		recoveredData = BlockchainInterface::ExtractData(txs);
 
-		int padding = recoveredData.size() - originalData.size();
-		recoveredData.erase(recoveredData.end() - padding, recoveredData.end());
+		recoveredData.resize(originalData.size());
 
 		BOOST_REQUIRE(originalData == recoveredData);
 	}
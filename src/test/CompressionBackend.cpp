@@ -0,0 +1,321 @@
+/**
+ * CompressionBackend.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "CompressionBackend.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+
+static const std::string Alphabet = "etaoinshrdlu ";
+
+/* Counts the characters of a text, giving every character of the alphabet and EoF a frequency */
+static FreqMap CountFrequencies(const Data& Text)
+{
+	FreqMap frequencies = HuffmanCoding::ComputeFrequencies(std::string(Text.begin(), Text.end()));
+
+	for(size_t i = 0; i < Alphabet.size(); i++)
+		frequencies[Alphabet[i]]++;
+	frequencies[EoF] = 1;
+
+	return frequencies;
+}
+
+/* Generates text with a skewed, non-dyadic character distribution */
+static Data SkewedText(size_t nChars)
+{
+	Data text;
+
+	for(size_t i = 0; i < nChars; i++)
+	{
+		size_t idx = 0;
+		while(idx + 1 < Alphabet.size() && rand() % 8 == 0)
+			idx++;
+		text.push_back(Alphabet[idx]);
+	}
+
+	return text;
+}
+
+/* Generates text of random words */
+static Data WordText(size_t nWords)
+{
+	const char* Words[] = {"the", "of", "and", "to", "in", "is", "that", "for", "it", "with",
+	                       "as", "was", "on", "be", "at", "by", "this", "had", "not", "are",
+	                       "but", "from", "or", "have", "an", "they", "which", "one", "you", "were"};
+	const size_t nChoices = sizeof(Words) / sizeof(Words[0]);
+	Data text;
+
+	for(size_t i = 0; i < nWords; i++)
+	{
+		if(i > 0)
+			text.push_back(' ');
+
+		const char* word = Words[rand() % nChoices];
+		text.insert(text.end(), word, word + strlen(word));
+	}
+
+	return text;
+}
+
+BOOST_AUTO_TEST_SUITE(CompressionBackendTests)
+
+BOOST_AUTO_TEST_CASE(RansRoundTrip)
+{
+	Data corpus = SkewedText(20000);
+	FreqMap frequencies = CountFrequencies(corpus);
+
+	RansBackend rans(frequencies);
+	HuffmanBackend huffman(HuffmanCoding::GenerateCodes(frequencies));
+
+	size_t nRansBits = 0, nHuffmanBits = 0;
+	for(unsigned int i = 0; i < 100; i++)
+	{
+		Data originalData = SkewedText(i * 40);
+
+		DataBits compData = rans.Compress(originalData);
+		BOOST_REQUIRE(rans.Decompress(compData) == originalData);
+
+		/* Padding behind the message is ignored */
+		compData.Pad(64);
+		BOOST_REQUIRE(rans.Decompress(compData) == originalData);
+
+		nRansBits += compData.size() - 64;
+		nHuffmanBits += huffman.Compress(originalData).size();
+	}
+
+	BOOST_TEST_MESSAGE("rANS " << nRansBits << " bits, Huffman " << nHuffmanBits << " bits");
+	BOOST_REQUIRE(nRansBits < nHuffmanBits);
+
+	/* The scaled frequencies describe the same coder */
+	RansBackend copy(rans.ScaledFrequencies());
+	Data originalData = SkewedText(500);
+	BOOST_REQUIRE(copy.Compress(originalData) == rans.Compress(originalData));
+
+	BOOST_REQUIRE_THROW(rans.Compress(Data(1, 'Z')), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(ContextRoundTrip)
+{
+	Data corpus = WordText(20000);
+	std::string text(corpus.begin(), corpus.end());
+
+	ContextFreqMap contextFrequencies = HuffmanCoding::ComputeContextFrequencies(text);
+	FreqMap frequencies = HuffmanCoding::ComputeFrequencies(text);
+	frequencies[EoF] = 1;
+
+	/* The text is preceded and followed by EoF */
+	BOOST_REQUIRE(contextFrequencies.at(EoF).size() == 1);
+	BOOST_REQUIRE(contextFrequencies.at(text[text.size() - 1]).at(EoF) == 1);
+
+	ContextBackend context(contextFrequencies);
+	RansBackend rans(frequencies);
+
+	size_t nContextBits = 0, nRansBits = 0;
+	for(unsigned int i = 0; i < 100; i++)
+	{
+		Data originalData = WordText(i);
+
+		DataBits compData = context.Compress(originalData);
+		BOOST_REQUIRE(context.Decompress(compData) == originalData);
+
+		nContextBits += compData.size();
+		nRansBits += rans.Compress(originalData).size();
+	}
+
+	BOOST_TEST_MESSAGE("Order-1 " << nContextBits << " bits, order-0 " << nRansBits << " bits");
+	BOOST_REQUIRE(nContextBits < nRansBits * 3 / 4);
+
+	/* Pairs that never occurred in the corpus are still coded */
+	Data originalData(2, 'v');
+	originalData.push_back('y');
+	BOOST_REQUIRE(context.Decompress(context.Compress(originalData)) == originalData);
+
+	BOOST_REQUIRE_THROW(context.Compress(Data(1, 'Z')), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(ContextLargeCounts)
+{
+	/* Counts of a large corpus, whose sums no longer fit a frequency */
+	ContextFreqMap contextFrequencies;
+	contextFrequencies['e']['e'] = INT_MAX;
+	contextFrequencies['e']['t'] = 1000;
+	contextFrequencies['t']['e'] = INT_MAX;
+	contextFrequencies['t'][EoF] = 1;
+
+	ContextBackend context(contextFrequencies);
+
+	/* The shared table of unseen contexts keeps the summed character */
+	const RansTable& fallback = context.Table('z');
+	BOOST_REQUIRE(fallback.freq['e'] > fallback.freq['t']);
+	BOOST_REQUIRE(fallback.freq['t'] > 0);
+
+	/* Smoothing a count of INT_MAX keeps the character */
+	BOOST_REQUIRE(context.Table('t').freq['e'] > context.Table('t').freq['t']);
+	BOOST_REQUIRE(context.Table('e').freq['e'] > context.Table('e').freq['t']);
+
+	Data originalData(5, 'e');
+	originalData.push_back('t');
+	originalData.push_back('e');
+	BOOST_REQUIRE(context.Decompress(context.Compress(originalData)) == originalData);
+}
+
+BOOST_AUTO_TEST_CASE(DictionaryRoundTrip)
+{
+	const std::string Boilerplate = "-----BEGIN SIGNED MESSAGE-----\nto whom it may concern,\n";
+
+	Data corpus = WordText(20000);
+	corpus.insert(corpus.end(), Boilerplate.begin(), Boilerplate.end());
+	std::shared_ptr<HuffmanBackend> huffman = std::make_shared<HuffmanBackend>(HuffmanCoding::GenerateCodes(CountFrequencies(corpus)));
+
+	Data dictionaryData = WordText(500);
+	std::string dictionary = Boilerplate + std::string(dictionaryData.begin(), dictionaryData.end());
+
+	DictionaryBackend backend(dictionary, huffman);
+
+	for(unsigned int i = 0; i < 100; i++)
+	{
+		Data originalData = WordText(i);
+		if(i % 2 == 0)
+			originalData.insert(originalData.begin(), Boilerplate.begin(), Boilerplate.end());
+
+		DataBits compData = backend.Compress(originalData);
+		BOOST_REQUIRE(backend.Decompress(compData) == originalData);
+
+		/* Padding behind the message is ignored */
+		compData.Pad(64);
+		BOOST_REQUIRE(backend.Decompress(compData) == originalData);
+	}
+
+	/* Boilerplate costs a single reference */
+	Data originalData(Boilerplate.begin(), Boilerplate.end());
+	BOOST_REQUIRE(backend.Compress(originalData).size() < 64);
+	BOOST_REQUIRE(huffman->Compress(originalData).size() > 200);
+
+	/* Repetitions within the message are referenced as well */
+	Data sentence = WordText(30);
+	originalData = sentence;
+	originalData.insert(originalData.end(), sentence.begin(), sentence.end());
+	BOOST_REQUIRE(backend.Compress(originalData).size() < huffman->Compress(sentence).size() + 64);
+
+	BOOST_REQUIRE_THROW(backend.Decompress(DataBits()), std::runtime_error);
+
+	/* A changed dictionary is told apart instead of expanding the wrong text */
+	std::string changed = dictionary;
+	changed[Boilerplate.size()] = (changed[Boilerplate.size()] == 'e') ? 't' : 'e';
+	DictionaryBackend other(changed, huffman);
+
+	originalData = Data(Boilerplate.begin(), Boilerplate.end());
+	BOOST_REQUIRE_THROW(other.Decompress(backend.Compress(originalData)), std::runtime_error);
+}
+
+/* Generates status lines of digits and signs */
+static Data StatusText(size_t nLines)
+{
+	std::string text;
+
+	for(size_t i = 0; i < nLines; i++)
+		text += "{\"height\": " + std::to_string(rand() % 1000000) + ", \"fee\": " + std::to_string(rand() % 1000) + "}\n";
+
+	return Data(text.begin(), text.end());
+}
+
+BOOST_AUTO_TEST_CASE(MultipleTables)
+{
+	Data words = WordText(20000), status = StatusText(2000);
+
+	std::vector<HuffCodeMap> tables(4);
+	tables[0] = HuffmanCoding::GenerateCodes(CountFrequencies(words));
+	tables[2] = HuffmanCoding::GenerateCodes(HuffmanCoding::ComputeFrequencies(std::string(status.begin(), status.end()) + EoF));
+
+	MultiTableBackend backend(tables);
+	HuffmanBackend wordBackend(tables[0]), statusBackend(tables[2]);
+
+	for(unsigned int i = 1; i < 50; i++)
+	{
+		Data originalData = WordText(i);
+		BOOST_REQUIRE(backend.SelectTable(originalData) == 0);
+
+		DataBits compData = backend.Compress(originalData);
+		BOOST_REQUIRE(compData.size() == MultiTableBackend::TableBits + wordBackend.Compress(originalData).size());
+		BOOST_REQUIRE(backend.Decompress(compData) == originalData);
+
+		originalData = StatusText(i);
+		BOOST_REQUIRE(backend.SelectTable(originalData) == 2);
+
+		compData = backend.Compress(originalData);
+		BOOST_REQUIRE(compData.Peek(0, MultiTableBackend::TableBits) == 2);
+		BOOST_REQUIRE(compData.size() == MultiTableBackend::TableBits + statusBackend.Compress(originalData).size());
+		BOOST_REQUIRE(backend.Decompress(compData) == originalData);
+	}
+
+	/* Characters of both kinds of text are only coded by the complete code */
+	tables[3] = HuffmanCoding::GenerateCodes(HuffmanCoding::ComputeFrequencies(std::string(words.begin(), words.end()) + std::string(status.begin(), status.end()) + EoF));
+	MultiTableBackend complete(tables);
+
+	Data mixed = WordText(100);
+	Data line = StatusText(1);
+	mixed.insert(mixed.end(), line.begin(), line.end());
+	BOOST_REQUIRE(complete.SelectTable(mixed) == 3);
+	BOOST_REQUIRE_THROW(backend.Compress(mixed), std::out_of_range);
+
+	/* Ids without a code are rejected */
+	DataBits compData;
+	compData.Append(1, MultiTableBackend::TableBits);
+	compData.Append(wordBackend.Compress(WordText(3)));
+	BOOST_REQUIRE_THROW(backend.Decompress(compData), std::runtime_error);
+
+	/* Prebuilt backends code alike to backends built from the codes */
+	std::vector<std::shared_ptr<const HuffmanBackend> > prebuilt(3);
+	prebuilt[0] = std::make_shared<HuffmanBackend>(HuffmanCoding::Encoder(tables[0]), HuffmanCoding::Decoder(tables[0]));
+	prebuilt[2] = std::make_shared<HuffmanBackend>(tables[2]);
+	MultiTableBackend shared(prebuilt);
+
+	for(unsigned int i = 1; i < 50; i++)
+	{
+		Data originalData = (i % 2) ? WordText(i) : StatusText(i);
+		BOOST_REQUIRE(shared.SelectTable(originalData) == backend.SelectTable(originalData));
+
+		DataBits compData = shared.Compress(originalData);
+		BOOST_REQUIRE(compData == backend.Compress(originalData));
+		BOOST_REQUIRE(shared.Decompress(compData) == originalData);
+	}
+
+	BOOST_REQUIRE_THROW(MultiTableBackend(std::vector<HuffCodeMap>(17)), std::runtime_error);
+	BOOST_REQUIRE_THROW(MultiTableBackend(std::vector<std::shared_ptr<const HuffmanBackend> >()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(BackendHeader)
+{
+	Data corpus = SkewedText(5000);
+	FreqMap frequencies = CountFrequencies(corpus);
+
+	BackendList backends;
+	backends.push_back(std::make_shared<HuffmanBackend>(HuffmanCoding::GenerateCodes(frequencies)));
+	backends.push_back(std::make_shared<RansBackend>(frequencies));
+
+	Data originalData = SkewedText(300);
+	for(BackendList::const_iterator it = backends.begin(); it != backends.end(); it++)
+	{
+		DataBits compData = Compression::Compress(originalData, **it);
+
+		BOOST_REQUIRE(compData.Peek(0, Compression::HeaderBits) == (*it)->Id());
+		BOOST_REQUIRE(Compression::Decompress(compData, backends) == originalData);
+	}
+
+	BackendList huffmanOnly(backends.begin(), backends.begin() + 1);
+	DataBits compData = Compression::Compress(originalData, *backends[1]);
+	BOOST_REQUIRE_THROW(Compression::Decompress(compData, huffmanOnly), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
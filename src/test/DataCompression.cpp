@@ -15,6 +15,10 @@
 #include "DataCompression.h"
 #include "Types.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
 using namespace HuffmanCoding;
 
 
@@ -34,6 +38,24 @@ BOOST_AUTO_TEST_CASE(CodeGeneration)
 	BOOST_REQUIRE(codes.left.at('e').size() == 4);
 }
 
+BOOST_AUTO_TEST_CASE(CodeLengthEdgeCases)
+{
+	FreqMap frequencies;
+	BOOST_REQUIRE(ComputeCodeLengths(frequencies).empty());
+
+	frequencies[EoF] = 5;
+	BOOST_REQUIRE(ComputeCodeLengths(frequencies).at(EoF) == 1);
+
+	/* Equal frequencies give a balanced tree */
+	for(int i = 0; i < 256; i++)
+		frequencies[(char)i] = 7;
+
+	CodeLengthMap lengths = ComputeCodeLengths(frequencies);
+	BOOST_REQUIRE(lengths.size() == 256);
+	for(CodeLengthMap::const_iterator it = lengths.begin(); it != lengths.end(); it++)
+		BOOST_REQUIRE(it->second == 8);
+}
+
 BOOST_AUTO_TEST_CASE(DataCompression)
 {
 	std::string str = "This is some arbitrary TestdataX";
@@ -50,6 +72,234 @@ BOOST_AUTO_TEST_CASE(DataCompression)
 	BOOST_REQUIRE(originalData == recoveredData);
 }
 
+BOOST_AUTO_TEST_CASE(CharDomainFilter)
+{
+	/* Newline, printable signs, digits and latin letters are kept */
+	auto IsKept = [](char ch) {
+		return ch == 0x0A || (0x20 <= ch && ch <= 0x5A) || (0x61 <= ch && ch <= 0x7A);
+	};
+
+	for(unsigned int i = 0; i < 500; i++)
+	{
+		std::string text;
+		for(unsigned int j = 0; j < i; j++)
+			text += (rand() % 4 == 0) ? (char) rand() : (char) (0x61 + rand() % 26);
+
+		std::string expected;
+		std::copy_if(text.begin(), text.end(), std::back_inserter(expected), IsKept);
+
+		TransformCharDomain(text);
+		BOOST_REQUIRE(text == expected);
+	}
+
+	std::string allChars;
+	for(int c = 0; c < 256; c++)
+		allChars += (char) c;
+	allChars += allChars;
+
+	size_t nKept = FilterCharDomain(&allChars[0], allChars.size());
+	BOOST_REQUIRE(nKept == 2 * (1 + 59 + 26));
+}
+
+BOOST_AUTO_TEST_CASE(CharHistogram)
+{
+	std::string text;
+	for(unsigned int i = 0; i < 10007; i++)
+		text += (char) (rand() % 7 == 0 ? rand() : 'e');
+
+	FreqMap expected;
+	for(std::string::const_iterator it = text.begin(); it != text.end(); it++)
+		expected[*it]++;
+
+	BOOST_REQUIRE(ComputeFrequencies(text) == expected);
+
+	/* Counting in pieces adds up */
+	Histogram counts;
+	counts.fill(0);
+	for(size_t pos = 0; pos < text.size(); pos += 1000)
+		AccumulateHistogram(counts, text.data() + pos, std::min<size_t>(1000, text.size() - pos));
+	BOOST_REQUIRE(ComputeFrequencies(counts) == expected);
+
+	/* Counts beyond the range of a frequency are scaled down */
+	counts.fill(0);
+	counts['a'] = 10000000000ULL;
+	counts['b'] = 5000000000ULL;
+	counts['c'] = 1;
+
+	FreqMap frequencies = ComputeFrequencies(counts);
+	BOOST_REQUIRE(frequencies.size() == 3);
+	BOOST_REQUIRE(frequencies['a'] == 2000000000);
+	BOOST_REQUIRE(frequencies['b'] == 1000000000);
+	BOOST_REQUIRE(frequencies['c'] == 1);
+}
+
+BOOST_AUTO_TEST_CASE(TableDecoder)
+{
+	/* Doubling frequencies yield codes spanning several secondary tables */
+	FreqMap frequencies;
+	for(char ch = 'a'; ch <= 'z'; ch++)
+		frequencies[ch] = 1 << (ch - 'a');
+	frequencies[EoF] = 1;
+
+	HuffCodeMap codes = GenerateCodes(frequencies);
+	Decoder decoder(codes);
+
+	BOOST_REQUIRE(codes.left.at('a').size() > 20);
+
+	for(unsigned int i = 0; i < 200; i++)
+	{
+		Data originalData;
+		for(unsigned int j = 0; j < i; j++)
+			originalData.push_back('a' + (j * 7 + i) % 26);
+
+		DataBits compData = Compress(originalData, codes);
+		BOOST_REQUIRE(Decompress(compData, decoder) == originalData);
+
+		/* Data behind the end-of-file character is ignored */
+		compData.Append(codes.left.at('z').begin(), codes.left.at('z').end());
+		BOOST_REQUIRE(Decompress(compData, decoder) == originalData);
+	}
+
+	/* A truncated code ends the decoding */
+	Data originalData(10, 'b');
+	DataBits compData = Compress(originalData, codes);
+	compData.resize(compData.size() - codes.left.at((char)EoF).size() - 1);
+	BOOST_REQUIRE(Decompress(compData, decoder) == Data(9, 'b'));
+}
+
+BOOST_AUTO_TEST_CASE(PackedEncoder)
+{
+	FreqMap frequencies;
+	for(char ch = 'a'; ch <= 'z'; ch++)
+		frequencies[ch] = 1 << (ch - 'a');
+	frequencies[EoF] = 1;
+
+	HuffCodeMap codes = GenerateCodes(frequencies);
+	Encoder encoder(codes);
+
+	for(unsigned int i = 0; i < 300; i++)
+	{
+		Data originalData;
+		for(unsigned int j = 0; j < i; j++)
+			originalData.push_back('a' + (j * 11 + i) % 26);
+
+		/* Codes appended one after another */
+		DataBits expected;
+		for(Data::const_iterator it = originalData.begin(); it != originalData.end(); it++)
+			expected.Append(codes.left.at(*it).begin(), codes.left.at(*it).end());
+		expected.Append(codes.left.at((char)EoF).begin(), codes.left.at((char)EoF).end());
+
+		BOOST_REQUIRE(Compress(originalData, encoder) == expected);
+
+		std::vector<BitView::Word> words;
+		size_t nBits = encoder.Encode(originalData, words);
+		BOOST_REQUIRE(BitView(words.data(), words.size(), 0, nBits) == BitView(expected));
+	}
+
+	BOOST_REQUIRE_THROW(Compress(Data(1, 'A'), encoder), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(StreamingEncoder)
+{
+	FreqMap frequencies;
+	for(char ch = 'a'; ch <= 'z'; ch++)
+		frequencies[ch] = 1 << (ch - 'a');
+	frequencies[EoF] = 1;
+
+	Encoder encoder(GenerateCodes(frequencies));
+
+	for(unsigned int i = 0; i < 300; i++)
+	{
+		std::string text;
+		for(unsigned int j = 0; j < i; j++)
+			text += (j % 7 == 0) ? '\t' : 'a' + (j * 11 + i) % 26;
+
+		/* Filter and encode the text in pieces of varying size */
+		DataBits bits;
+		StreamEncoder stream(encoder, bits);
+		std::string filtered;
+		for(size_t pos = 0; pos < text.size(); pos += 1 + pos % 13)
+		{
+			std::string piece = text.substr(pos, 1 + pos % 13);
+			piece.resize(FilterCharDomain(&piece[0], piece.size()));
+
+			stream.Write(piece.data(), piece.size());
+			filtered += piece;
+		}
+		stream.Finish();
+
+		TransformCharDomain(text);
+		BOOST_REQUIRE(filtered == text);
+		BOOST_REQUIRE(bits == Compress(Data(text.begin(), text.end()), encoder));
+	}
+
+	DataBits bits;
+	StreamEncoder stream(encoder, bits);
+	BOOST_REQUIRE_THROW(stream.Write("A", 1), std::out_of_range);
+
+	stream.Finish();
+	BOOST_REQUIRE_THROW(stream.Write("a", 1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(CanonicalCodes)
+{
+	FreqMap frequencies = ComputeFrequencies("go go gophers");
+	frequencies[EoF] = 1;
+
+	CodeLengthMap lengths = ComputeCodeLengths(frequencies);
+	HuffCodeMap codes = GenerateCanonicalCodes(lengths);
+
+	BOOST_REQUIRE(IsCanonical(codes));
+	BOOST_REQUIRE(GetCodeLengths(codes) == lengths);
+	BOOST_REQUIRE(GetCodeLengths(GenerateCodes(frequencies)) == lengths);
+
+	/* Codes ascend with the code length and then with the character */
+	std::vector<std::pair<unsigned int, unsigned char> > order;
+	for(CodeLengthMap::const_iterator it = lengths.begin(); it != lengths.end(); it++)
+		order.push_back(std::make_pair(it->second, (unsigned char)it->first));
+	std::sort(order.begin(), order.end());
+
+	BOOST_REQUIRE(codes.left.at(order[0].second) == HuffCode(order[0].first, false));
+	for(unsigned int i = 1; i < order.size(); i++)
+		BOOST_REQUIRE(codes.left.at(order[i - 1].second) < codes.left.at(order[i].second));
+
+	Data originalData = {'g', 'o', ' ', 'p', 'h', 'e', 'r', 's'};
+	DataBits compData = Compress(originalData, Encoder(lengths));
+	BOOST_REQUIRE(compData == Compress(originalData, codes));
+	BOOST_REQUIRE(Decompress(compData, Decoder(lengths)) == originalData);
+}
+
+BOOST_AUTO_TEST_CASE(LengthLimitedCodes)
+{
+	FreqMap frequencies;
+	for(char ch = 'a'; ch <= 'z'; ch++)
+		frequencies[ch] = 1 << (ch - 'a');
+	frequencies[EoF] = 1;
+
+	for(unsigned int nMaxBits = 5; nMaxBits <= 26; nMaxBits++)
+	{
+		CodeLengthMap lengths = ComputeCodeLengths(frequencies, nMaxBits);
+
+		/* The code stays complete, so the lengths fill the code space exactly */
+		uint64_t total = 0;
+		for(CodeLengthMap::const_iterator it = lengths.begin(); it != lengths.end(); it++)
+		{
+			BOOST_REQUIRE(1 <= it->second && it->second <= nMaxBits);
+			total += 1ULL << (nMaxBits - it->second);
+		}
+		BOOST_REQUIRE(total == 1ULL << nMaxBits);
+
+		/* More frequent characters never get longer codes */
+		BOOST_REQUIRE(lengths.at('z') <= lengths.at('m'));
+		BOOST_REQUIRE(lengths.at('m') <= lengths.at('a'));
+
+		Data originalData = {'a', 'z', 'q', 'b', 'a'};
+		BOOST_REQUIRE(Decompress(Compress(originalData, Encoder(lengths)), Decoder(lengths)) == originalData);
+	}
+
+	BOOST_REQUIRE_THROW(ComputeCodeLengths(frequencies, 4), std::runtime_error);
+}
+
 //BOOST_AUTO_TEST_CASE(GenerateCodemap)
 //{
 //	std::vector<boost::filesystem::path> files;
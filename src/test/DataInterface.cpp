@@ -12,6 +12,7 @@
 
 #include "Utilities.h"
 #include "DataInterface.h"
+#include "Maths.h"
 
 using namespace DataInterface;
 
@@ -26,7 +27,7 @@ BOOST_AUTO_TEST_CASE(DataEncoding_Pubkey)
 		DataBits recoveredData;
 
 		CPubKey pk = EncodeDataInPubkey(originalData, 255 - (1 + i % 250));
-		recoveredData = DecodeDataInPubkey(pk, 255 - (1 + i % 250));
+		DecodeDataInPubkey(pk, 255 - (1 + i % 250), recoveredData);
 
 		BOOST_REQUIRE(originalData == recoveredData);
 	}
@@ -40,7 +41,7 @@ BOOST_AUTO_TEST_CASE(DataEncoding_SeqNr)
 		DataBits recoveredData;
 
 		unsigned int seqnr = EncodeDataInSequenceNr(originalData);
-		recoveredData = DecodeDataInSequenceNr(seqnr);
+		DecodeDataInSequenceNr(seqnr, recoveredData);
 
 		BOOST_REQUIRE(originalData == recoveredData);
 	}
@@ -65,7 +66,7 @@ BOOST_AUTO_TEST_CASE(DataEncoding_TxAmounts)
 		DataBits recoveredData;
 
 		std::vector<uint64_t> vals = EncodeDataInValues(originalData, pow(10,3+(i%13)), 2+(i%29));
-		recoveredData = DecodeDataInValues(vals);
+		DecodeDataInValues(vals, recoveredData);
 
 		BOOST_REQUIRE(originalData == recoveredData);
 	}
@@ -90,7 +91,49 @@ BOOST_AUTO_TEST_CASE(DataEncoding_TxPermutations)
 		DataBits recoveredData;
 
 		std::vector<uint16_t> perm = EncodeDataInPermutation(originalData, 2+(i % 39));
-		recoveredData = DecodeDataInPermutation(perm);
+		DecodeDataInPermutation(perm, recoveredData);
+
+		BOOST_REQUIRE(originalData == recoveredData);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(EmbeddableBits_Bounds)
+{
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		uint64_t n = pow(10,(i%16)) + i;
+		uint16_t k = 2+(i%39);
+
+		uint32_t nBits = EmbeddableBitsInValues(n, k);
+		uint32_t nBound = EmbeddableBitsInValuesBound(n, k);
+
+		BOOST_REQUIRE(Math::NumberCompositions(n, k) >> nBits == 1);
+		BOOST_REQUIRE(nBits <= nBound && nBound <= nBits + 1);
+
+		nBits = EmbeddableBitsInPermutation(k);
+		nBound = EmbeddableBitsInPermutationBound(k);
+
+		BOOST_REQUIRE(nBits <= nBound && nBound <= nBits + 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DataEncoding_TxPermutationBlocks)
+{
+	BOOST_REQUIRE(EmbeddableBitsInPermutationBlocks(14) == 36);
+	BOOST_REQUIRE(EmbeddableBitsInPermutationBlocks(100) == 520);
+
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		uint16_t nParts = 2+(i % 199);
+		uint32_t MaxBits = EmbeddableBitsInPermutationBlocks(nParts);
+
+		BOOST_REQUIRE(MaxBits <= EmbeddableBitsInPermutationBound(nParts));
+
+		DataBits originalData = Utilities::GenerateRandomBits(MaxBits);
+		DataBits recoveredData;
+
+		std::vector<uint16_t> perm = EncodeDataInPermutationBlocks(originalData, nParts);
+		DecodeDataInPermutationBlocks(perm, recoveredData);
 
 		BOOST_REQUIRE(originalData == recoveredData);
 	}
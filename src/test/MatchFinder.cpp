@@ -0,0 +1,103 @@
+/**
+ * MatchFinder.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "MatchFinder.h"
+
+#include <cstdlib>
+
+
+/* Generates text of random characters from a small alphabet */
+static std::string RandomText(size_t nChars)
+{
+	std::string text;
+
+	for(size_t i = 0; i < nChars; i++)
+		text += "abcd efgh"[rand() % 9];
+
+	return text;
+}
+
+BOOST_AUTO_TEST_SUITE(MatchFinderTests)
+
+BOOST_AUTO_TEST_CASE(ParseExpand)
+{
+	const std::string Dictionary = RandomText(5000);
+	MatchFinder finder(Dictionary);
+
+	for(unsigned int i = 0; i < 200; i++)
+	{
+		/* Mix random text with pieces of the dictionary and of the message so far */
+		std::string text;
+		while(text.size() < i * 10)
+		{
+			size_t nChars = 1 + rand() % 40;
+			switch(rand() % 3)
+			{
+				case 0: text += RandomText(nChars); break;
+				case 1: text += Dictionary.substr(rand() % Dictionary.size(), nChars); break;
+				case 2: text += text.substr(text.empty() ? 0 : rand() % text.size(), nChars); break;
+			}
+		}
+
+		Data originalData(text.begin(), text.end());
+		std::vector<MatchFinder::Token> tokens = finder.Parse(originalData);
+
+		BOOST_REQUIRE(!tokens.empty());
+		BOOST_REQUIRE(tokens.back().length == 0);
+
+		/* Collect the literals behind the token boundaries */
+		Data literals;
+		size_t pos = 0;
+		for(size_t j = 0; j < tokens.size(); j++)
+		{
+			literals.insert(literals.end(), originalData.begin() + pos, originalData.begin() + pos + tokens[j].nLiterals);
+			pos += tokens[j].nLiterals + tokens[j].length;
+
+			if(j + 1 < tokens.size())
+			{
+				BOOST_REQUIRE(tokens[j].length >= MatchFinder::MinMatch);
+				BOOST_REQUIRE(tokens[j].distance > 0);
+			}
+		}
+
+		BOOST_REQUIRE(pos == originalData.size());
+		BOOST_REQUIRE(finder.Expand(tokens, literals) == originalData);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(DictionaryMatches)
+{
+	MatchFinder finder("Best regards, Alice");
+
+	/* A phrase of the dictionary becomes a single match */
+	std::string text = "Hi Bob, Best regards, Alice";
+	std::vector<MatchFinder::Token> tokens = finder.Parse(Data(text.begin(), text.end()));
+
+	BOOST_REQUIRE(tokens.size() == 2);
+	BOOST_REQUIRE(tokens[0].nLiterals == 8);
+	BOOST_REQUIRE(tokens[0].length == 19);
+	BOOST_REQUIRE(tokens[0].distance == 19 + 8);
+
+	/* A run repeating itself becomes an overlapping match */
+	text = "zzzzzzzzzzzzzzzzzzzz";
+	tokens = finder.Parse(Data(text.begin(), text.end()));
+
+	BOOST_REQUIRE(tokens.size() == 2);
+	BOOST_REQUIRE(tokens[0].nLiterals == 1);
+	BOOST_REQUIRE(tokens[0].distance == 1);
+	BOOST_REQUIRE(finder.Expand(tokens, Data(1, 'z')) == Data(text.begin(), text.end()));
+
+	BOOST_REQUIRE(finder.Parse(Data()).size() == 1);
+	BOOST_REQUIRE_THROW(finder.Expand(tokens, Data()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,9 @@
 
 #include "Maths.h"
 
+#include <algorithm>
+#include <numeric>
+
 using namespace Math;
 
 
@@ -49,6 +52,29 @@ BOOST_AUTO_TEST_CASE(NumberCompositions_Test)
 	BOOST_REQUIRE(NumberCompositions(1000000, 20) == bin);
 }
 
+BOOST_AUTO_TEST_CASE(BinomialSteps_Test)
+{
+	for(uint64_t n = 1; n < 200; n++)
+	{
+		for(uint64_t k = 0; k < 16; k++)
+		{
+			BOOST_REQUIRE(BinomialStepDown(BinomialCoefficient(n, k), n, k) == BinomialCoefficient(n - 1, k));
+			BOOST_REQUIRE(BinomialStepUp(BinomialCoefficient(n, k), n, k) == BinomialCoefficient(n + 1, k));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CompositionRoundTrip)
+{
+	std::vector<uint64_t> comp1 = {0,0,7,0,5};
+	std::vector<uint64_t> comp2 = {546,1000000,12,99999,546,546,3,0,0,7777,546,546,1,100000000};
+
+	uint64_t n2 = std::accumulate(comp2.begin(), comp2.end(), (uint64_t) 0);
+
+	BOOST_REQUIRE(IntegerToComposition(CompositionToInteger(comp1), 12, 5) == comp1);
+	BOOST_REQUIRE(IntegerToComposition(CompositionToInteger(comp2), n2, 14) == comp2);
+}
+
 
 BOOST_AUTO_TEST_CASE(PermutationToInt)
 {
@@ -68,6 +94,42 @@ BOOST_AUTO_TEST_CASE(IntToPermutation)
 	BOOST_REQUIRE(IntegerToPermutation(1000000,10) == perm2);
 }
 
+BOOST_AUTO_TEST_CASE(PermutationRoundTrip)
+{
+	for(uint16_t k = 2; k <= 64; k++)
+	{
+		std::vector<uint16_t> perm(k);
+		std::iota(perm.begin(), perm.end(), 0);
+		std::random_shuffle(perm.begin(), perm.end());
+
+		BigInt idx = PermutationToInteger(perm);
+
+		BOOST_REQUIRE(idx < Factorial(k));
+		BOOST_REQUIRE(IntegerToPermutation(idx, k) == perm);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FixedWidthBackends)
+{
+	BOOST_REQUIRE(SelectBackend(64) == BACKEND_64);
+	BOOST_REQUIRE(SelectBackend(65) == BACKEND_128);
+	BOOST_REQUIRE(SelectBackend(512) == BACKEND_512);
+	BOOST_REQUIRE(SelectBackend(513) == BACKEND_BIGINT);
+
+	std::vector<uint16_t> perm = {2,7,8,3,9,1,5,6,0,4};
+	std::vector<uint64_t> comp = {546,1000000,12,99999,546};
+
+	BOOST_REQUIRE(Combinatorics<UInt64>::PermutationToInteger(perm) == 1000000);
+	BOOST_REQUIRE(Combinatorics<UInt64>::IntegerToPermutation(1000000, 10) == perm);
+
+	BOOST_REQUIRE(Combinatorics<UInt128>::IntegerToComposition(
+			Combinatorics<UInt128>::CompositionToInteger(comp), 1101103, 5) == comp);
+	BOOST_REQUIRE(Combinatorics<UInt256>::IntegerToComposition(
+			Combinatorics<UInt256>::CompositionToInteger(comp), 1101103, 5) == comp);
+	BOOST_REQUIRE(Combinatorics<UInt512>::NumberCompositions(1000000, 20).str() ==
+			NumberCompositions(1000000, 20).str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -0,0 +1,101 @@
+/**
+ * Random.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "Random.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+BOOST_AUTO_TEST_SUITE(RandomTests)
+
+BOOST_AUTO_TEST_CASE(ChaCha20Block)
+{
+	/* Block function test vector of RFC 7539, section 2.3.2 */
+	const unsigned char Expected[64] = {
+			0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15, 0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+			0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03, 0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+			0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09, 0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+			0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9, 0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e};
+
+	unsigned char key[32];
+	unsigned char block[64];
+	for(unsigned int i = 0; i < 32; i++)
+		key[i] = i;
+
+	/* The 96-bit nonce of the RFC shares its first word with the block counter */
+	Random::ChaCha20 cipher(key, 0x4a000000);
+	cipher.Seek(0x0900000000000001ULL);
+	cipher.Keystream(block, 64);
+
+	BOOST_REQUIRE(memcmp(block, Expected, 64) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(PartialBlocks)
+{
+	unsigned char key[32] = {0};
+	unsigned char whole[192];
+	unsigned char parts[192];
+
+	Random::ChaCha20(key).Keystream(whole, 192);
+
+	Random::ChaCha20 cipher(key);
+	cipher.Keystream(parts, 10);
+	cipher.Keystream(parts + 64, 128);
+
+	BOOST_REQUIRE(memcmp(whole, parts, 10) == 0);
+	BOOST_REQUIRE(memcmp(whole + 64, parts + 64, 128) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(FillAndReadBits)
+{
+	/* Sizes around the buffer of the generator */
+	for(unsigned int nBytes = 1; nBytes < 3000; nBytes = nBytes * 3 + 1)
+	{
+		std::vector<unsigned char> a(nBytes), b(nBytes);
+		Random::Fill(a.data(), a.size());
+		Random::Fill(b.data(), b.size());
+
+		if(nBytes >= 16)
+			BOOST_REQUIRE(a != b);
+	}
+
+	Random::BitReader reader;
+	unsigned int nOnes = 0;
+	for(unsigned int i = 0; i < 10000; i++)
+	{
+		unsigned int nBits = 1 + i % 64;
+		uint64_t bits = reader.Read(nBits);
+
+		if(nBits < 64)
+			BOOST_REQUIRE(bits >> nBits == 0);
+		nOnes += reader.ReadBit();
+	}
+
+	BOOST_REQUIRE(4500 < nOnes && nOnes < 5500);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadsDrawIndependently)
+{
+	unsigned char a[32], b[32];
+
+	std::thread first([&]{ Random::Fill(a, 32); });
+	std::thread second([&]{ Random::Fill(b, 32); });
+	first.join();
+	second.join();
+
+	BOOST_REQUIRE(memcmp(a, b, 32) != 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
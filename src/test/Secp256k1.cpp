@@ -0,0 +1,76 @@
+/**
+ * Secp256k1.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "Secp256k1.h"
+#include "Types.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+/* Generates random compressed public key candidates with an even y-coordinate */
+static std::vector<CPubKey> RandomCandidates(unsigned int nCandidates)
+{
+	std::vector<CPubKey> candidates;
+	unsigned char vch[33];
+
+	for(unsigned int i = 0; i < nCandidates; i++)
+	{
+		vch[0] = 0x02;
+		for(unsigned int j = 1; j < 33; j++)
+			vch[j] = rand() & 0xFF;
+
+		candidates.push_back(CPubKey(vch, vch + 33));
+	}
+
+	return candidates;
+}
+
+BOOST_AUTO_TEST_SUITE(Secp256k1Tests)
+
+BOOST_AUTO_TEST_CASE(AgainstOpenSSL)
+{
+	std::vector<CPubKey> candidates = RandomCandidates(2000);
+
+	for(unsigned int i = 0; i < candidates.size(); i++)
+	{
+		BOOST_REQUIRE(Secp256k1::IsValidX(candidates[i].begin() + 1) == candidates[i].IsFullyValid());
+	}
+
+	unsigned char prime[32];
+	memset(prime, 0xFF, 32);
+	prime[27] = 0xFE;
+	prime[30] = 0xFC;
+	prime[31] = 0x2F;
+
+	BOOST_REQUIRE(!Secp256k1::IsValidX(prime));
+}
+
+BOOST_AUTO_TEST_CASE(BatchSearch)
+{
+	std::vector<CPubKey> candidates = RandomCandidates(64);
+	std::vector<unsigned char> xs;
+
+	size_t first = candidates.size();
+	for(unsigned int i = 0; i < candidates.size(); i++)
+	{
+		xs.insert(xs.end(), candidates[i].begin() + 1, candidates[i].end());
+		if(first == candidates.size() && candidates[i].IsFullyValid())
+			first = i;
+	}
+
+	BOOST_REQUIRE(Secp256k1::FindValidX(&xs[0], candidates.size()) == first);
+	BOOST_REQUIRE(Secp256k1::FindValidX(&xs[0], 0) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,10 +14,18 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 namespace fs = boost::filesystem;
 using namespace Serialization;
 
+/* Writes a code table with the given flags and entries behind its header */
+static void WriteCodeTable(const std::string& Path, char Flags, size_t nCodes, const std::string& Entries)
+{
+	fs::ofstream ofs(Path, std::ios::binary);
+	ofs << "BMSH" << (char) 1 << Flags << (char) (nCodes - 1) << Entries;
+}
+
 
 BOOST_AUTO_TEST_SUITE(SerializationTests)
 
@@ -40,6 +48,105 @@ BOOST_AUTO_TEST_CASE(HuffmanMapSerialization)
 	BOOST_REQUIRE(codesA == codesB);
 }
 
+BOOST_AUTO_TEST_CASE(CodeTableSerialization)
+{
+	FreqMap frequencies = HuffmanCoding::ComputeFrequencies("go go gophers");
+	HuffCodeMap canonical = HuffmanCoding::GenerateCanonicalCodes(HuffmanCoding::ComputeCodeLengths(frequencies));
+	HuffCodeMap legacy = HuffmanCoding::GenerateCodes(frequencies);
+
+	SerializeCodeTable(canonical, "CodeTable.tmp");
+	BOOST_REQUIRE(DeserializeCodeTable("CodeTable.tmp") == canonical);
+
+	SerializeCodeTable(legacy, "CodeTable.tmp");
+	BOOST_REQUIRE(DeserializeCodeTable("CodeTable.tmp") == legacy);
+
+	/* Lengths only, one byte each besides the character */
+	SerializeCodeTable(canonical, "CodeTable.tmp");
+	BOOST_REQUIRE(fs::file_size("CodeTable.tmp") == 7 + 2 * canonical.size());
+	BOOST_REQUIRE(fs::remove("CodeTable.tmp"));
+}
+
+BOOST_AUTO_TEST_CASE(CorruptCodeTable)
+{
+	/* Codes 0 and 10, given explicitly */
+	WriteCodeTable("CodeTable.tmp", 1, 2, std::string("a\x01\x00" "b\x02\x80", 6));
+	BOOST_REQUIRE(DeserializeCodeTable("CodeTable.tmp").size() == 2);
+
+	/* Code 0 is a prefix of 01 */
+	WriteCodeTable("CodeTable.tmp", 1, 2, std::string("a\x01\x00" "b\x02\x40", 6));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+
+	/* Code without bits */
+	WriteCodeTable("CodeTable.tmp", 1, 2, std::string("a\x00" "b\x01\x80", 5));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+
+	/* Repeated character, explicitly and by length */
+	WriteCodeTable("CodeTable.tmp", 1, 2, std::string("a\x01\x00" "a\x01\x80", 6));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+	WriteCodeTable("CodeTable.tmp", 0, 2, std::string("a\x01" "a\x01", 4));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+
+	/* Code longer than 64 bits */
+	WriteCodeTable("CodeTable.tmp", 0, 2, std::string("a\x01" "b\x41", 4));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+
+	/* Trailing byte */
+	WriteCodeTable("CodeTable.tmp", 0, 2, std::string("a\x01" "b\x01" "c", 5));
+	BOOST_REQUIRE_THROW(DeserializeCodeTable("CodeTable.tmp"), std::runtime_error);
+
+	BOOST_REQUIRE(fs::remove("CodeTable.tmp"));
+}
+
+BOOST_AUTO_TEST_CASE(HuffmanCodeConversion)
+{
+	HuffCodeMap legacy = DeserializeHuffmanCode("config/huffcode.map");
+
+	ConvertHuffmanCode("config/huffcode.map", "CodeTable.tmp");
+	BOOST_REQUIRE(DeserializeCodeTable("CodeTable.tmp") == legacy);
+
+	ConvertHuffmanCode("config/huffcode.map", "CodeTable.tmp", 15);
+	HuffCodeMap limited = DeserializeCodeTable("CodeTable.tmp");
+	BOOST_REQUIRE(fs::remove("CodeTable.tmp"));
+
+	BOOST_REQUIRE(limited.size() == legacy.size());
+	BOOST_REQUIRE(HuffmanCoding::IsCanonical(limited));
+	for(HuffCodeMap::left_const_iterator it = limited.left.begin(); it != limited.left.end(); it++)
+		BOOST_REQUIRE(it->second.size() <= 15);
+}
+
+BOOST_AUTO_TEST_CASE(CompiledInCode)
+{
+	HuffCodeMap legacy = DeserializeHuffmanCode("config/huffcode.map");
+	BOOST_REQUIRE(HuffmanCoding::DefaultCode() == legacy);
+
+	std::string text = "The compiled-in code matches the shipped one.\n";
+	Data originalData(text.begin(), text.end());
+
+	DataBits compData = HuffmanCoding::DefaultEncoder().Encode(originalData);
+	BOOST_REQUIRE(compData == HuffmanCoding::Compress(originalData, legacy));
+	BOOST_REQUIRE(HuffmanCoding::DefaultDecoder().Decode(compData) == originalData);
+}
+
+BOOST_AUTO_TEST_CASE(FrequencySerialization)
+{
+	FreqMap frequencies = HuffmanCoding::ComputeFrequencies("go go gophers");
+	frequencies[(char)0xFF] = 70000;
+
+	SerializeFrequencies(frequencies, "Frequencies.tmp");
+	BOOST_REQUIRE(DeserializeFrequencies("Frequencies.tmp") == frequencies);
+	BOOST_REQUIRE(fs::remove("Frequencies.tmp"));
+}
+
+BOOST_AUTO_TEST_CASE(ContextFrequencySerialization)
+{
+	ContextFreqMap frequencies = HuffmanCoding::ComputeContextFrequencies("go go gophers");
+	frequencies[(char)0xFF][(char)0x80] = 70000;
+
+	SerializeContextFrequencies(frequencies, "ContextFrequencies.tmp");
+	BOOST_REQUIRE(DeserializeContextFrequencies("ContextFrequencies.tmp") == frequencies);
+	BOOST_REQUIRE(fs::remove("ContextFrequencies.tmp"));
+}
+
 BOOST_AUTO_TEST_CASE(KeypairMapSerialization)
 {
 	KeypairMap keymapA;
@@ -0,0 +1,58 @@
+/**
+ * ThreadPool.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "Main.cpp"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTests)
+
+BOOST_AUTO_TEST_CASE(ResultsInOrder)
+{
+	ThreadPool pool(4);
+	BOOST_REQUIRE(pool.size() == 4);
+
+	for(unsigned int nJobs = 0; nJobs < 100; nJobs += 7)
+	{
+		std::vector<size_t> results(nJobs, 0);
+		pool.Run(nJobs, [&](size_t i){ results[i] = i * i; });
+
+		for(unsigned int i = 0; i < nJobs; i++)
+			BOOST_REQUIRE(results[i] == i * i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ExceptionPropagation)
+{
+	ThreadPool pool(3);
+	std::vector<int> finished(50, 0);
+
+	BOOST_REQUIRE_THROW(pool.Run(finished.size(), [&](size_t i)
+	{
+		if(i == 17)
+			throw std::runtime_error("[ExceptionPropagation] Failing job");
+		finished[i] = 1;
+	}), std::runtime_error);
+
+	for(unsigned int i = 0; i < finished.size(); i++)
+		BOOST_REQUIRE(finished[i] == (i != 17));
+
+	/* The pool stays usable after a failed batch */
+	std::vector<int> results(10, 0);
+	pool.Run(results.size(), [&](size_t i){ results[i] = 1; });
+	BOOST_REQUIRE(std::count(results.begin(), results.end(), 1) == 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
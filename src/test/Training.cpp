@@ -0,0 +1,124 @@
+/**
+ * Training.cpp
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include "Main.cpp"
+
+#include "Training.h"
+
+#include <cstdlib>
+
+namespace fs = boost::filesystem;
+
+
+BOOST_AUTO_TEST_SUITE(TrainingTests)
+
+BOOST_AUTO_TEST_CASE(CorpusCounting)
+{
+	fs::create_directories("Corpus.tmp/sub");
+
+	const char* Paths[] = {"Corpus.tmp/a.txt", "Corpus.tmp/sub/b.txt", "Corpus.tmp/empty.txt"};
+	std::string texts[3];
+	for(unsigned int i = 0; i < 100000; i++)
+		texts[i % 2] += (rand() % 10 == 0) ? (char) rand() : (char) ('a' + rand() % 5);
+
+	Histogram expected;
+	expected.fill(0);
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		fs::ofstream ofs(Paths[i], std::ios::binary);
+		ofs << texts[i];
+
+		for(std::string::const_iterator it = texts[i].begin(); it != texts[i].end(); it++)
+			expected[(unsigned char) *it]++;
+	}
+
+	std::vector<std::string> paths = Training::ListCorpus("Corpus.tmp");
+	BOOST_REQUIRE(paths.size() == 3);
+
+	ThreadPool pool(3);
+	Training::CorpusCounts counts = Training::CountCorpus(paths, pool);
+
+	BOOST_REQUIRE(counts.counts == expected);
+	BOOST_REQUIRE(counts.nFiles == 3);
+	BOOST_REQUIRE(counts.nBytes == texts[0].size() + texts[1].size());
+
+	/* Only characters of the restricted alphabet and one EoF per file remain */
+	FreqMap frequencies = Training::CorpusFrequencies(counts);
+	for(FreqMap::const_iterator it = frequencies.begin(); it != frequencies.end(); it++)
+		BOOST_REQUIRE(it->first == EoF || !HuffmanCoding::IsCharInvalid(it->first));
+	BOOST_REQUIRE(frequencies.at(EoF) == 3);
+	BOOST_REQUIRE(frequencies.at('a') == (int) expected['a']);
+
+	/* Successions are counted on the filtered text of every file */
+	ContextFreqMap contexts;
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		std::string text = texts[i];
+		HuffmanCoding::TransformCharDomain(text);
+
+		ContextFreqMap fileContexts = HuffmanCoding::ComputeContextFrequencies(text);
+		for(ContextFreqMap::const_iterator it = fileContexts.begin(); it != fileContexts.end(); it++)
+		{
+			for(FreqMap::const_iterator jt = it->second.begin(); jt != it->second.end(); jt++)
+				contexts[it->first][jt->first] += jt->second;
+		}
+	}
+	BOOST_REQUIRE(Training::CorpusContextFrequencies(counts) == contexts);
+
+	/* Chunk boundaries do not change the counts */
+	for(size_t nChunkSize = 1; nChunkSize <= 1000; nChunkSize *= 10)
+	{
+		Training::CorpusCounts chunked = Training::CountCorpus(paths, pool, nChunkSize);
+
+		BOOST_REQUIRE(chunked.counts == counts.counts);
+		BOOST_REQUIRE(chunked.contexts == counts.contexts);
+		BOOST_REQUIRE(chunked.nBytes == counts.nBytes);
+	}
+
+	BOOST_REQUIRE_THROW(Training::CountCorpus(paths, pool, 0), std::runtime_error);
+	BOOST_REQUIRE_THROW(Training::CountCorpus(std::vector<std::string>(1, "Corpus.tmp/missing.txt"), pool), std::exception);
+
+	BOOST_REQUIRE(fs::remove_all("Corpus.tmp") == 5);
+	BOOST_REQUIRE_THROW(Training::ListCorpus("Corpus.tmp"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ExpectedCodeLength)
+{
+	FreqMap frequencies;
+	frequencies['a'] = 2;
+	frequencies['b'] = 1;
+	frequencies['c'] = 1;
+	frequencies[EoF] = 1000;
+
+	BOOST_REQUIRE_CLOSE(Training::Entropy(frequencies), 1.5, 1e-9);
+
+	CodeLengthMap lengths;
+	lengths['a'] = 1;
+	lengths['b'] = 2;
+	lengths['c'] = 2;
+	BOOST_REQUIRE_CLOSE(Training::BitsPerChar(frequencies, lengths), 1.5, 1e-9);
+
+	lengths.erase('c');
+	BOOST_REQUIRE_THROW(Training::BitsPerChar(frequencies, lengths), std::out_of_range);
+
+	/* A trained code lies within one bit of the entropy */
+	frequencies.erase(EoF);
+	frequencies['d'] = 7;
+	frequencies['e'] = 3;
+	lengths = HuffmanCoding::ComputeCodeLengths(frequencies);
+
+	double entropy = Training::Entropy(frequencies);
+	double nBits = Training::BitsPerChar(frequencies, lengths);
+	BOOST_REQUIRE(entropy <= nBits && nBits < entropy + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
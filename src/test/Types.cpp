@@ -20,7 +20,7 @@ BOOST_AUTO_TEST_SUITE(TypesTests)
 BOOST_AUTO_TEST_CASE(CharToBoolConversion)
 {
 	char c = 'a';
-	DataBits vec = {false, true, true, false, false, false, false, true};
+	std::vector<bool> vec = {false, true, true, false, false, false, false, true};
 
 	BOOST_REQUIRE(CharToBoolVec(c) == vec);
 
@@ -29,7 +29,7 @@ BOOST_AUTO_TEST_CASE(CharToBoolConversion)
 BOOST_AUTO_TEST_CASE(BoolToCharConversion)
 {
 	char c = 'a';
-	DataBits vec = {false, true, true, false, false, false, false, true};
+	std::vector<bool> vec = {false, true, true, false, false, false, false, true};
 
 	BOOST_REQUIRE(c == BoolVecToChar(vec));
 }
@@ -67,13 +67,38 @@ BOOST_AUTO_TEST_CASE(IntToBitsConversion)
 	BigInt num("86738642548785208971184551234260714564");
 
 	DataBits tmp = IntToDataBits(num);
+	DataBits bits;
 
 	if((tmp.size() % 8) != 0)
 	{
-		tmp.insert(tmp.begin(), 8 - (tmp.size() % 8), false);
+		PadBits(bits, 8 - (tmp.size() % 8));
 	}
+	bits.Append(tmp);
 
-	BOOST_REQUIRE(BitsToData(tmp) == data);
+	BOOST_REQUIRE(BitsToData(bits) == data);
+}
+
+BOOST_AUTO_TEST_CASE(IntBitsRoundTrip)
+{
+	for(int i = 1; i < 600; i++)
+	{
+		DataBits bits = Utilities::GenerateRandomBits(i);
+		BigInt num = DataBitsToInt(bits);
+
+		BigInt expected = 0;
+		for(size_t j = 0; j < bits.size(); j++)
+		{
+			expected = 2 * expected + bits[j];
+		}
+		BOOST_REQUIRE(num == expected);
+
+		DataBits tmp = IntToDataBits(num);
+		DataBits padded;
+		PadBits(padded, bits.size() - tmp.size());
+		padded.Append(tmp);
+
+		BOOST_REQUIRE(padded == bits);
+	}
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -14,8 +14,47 @@
 #include "Serialization.h"
 #include "BlockchainInterface.h"
 
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <sstream>
+
 using namespace Utilities;
 
+namespace fs = boost::filesystem;
+
+/* Makes a directory the working directory for its lifetime */
+struct ScopedWorkingDirectory
+{
+	fs::path previous;
+
+	explicit ScopedWorkingDirectory(const fs::path& dir) : previous(fs::current_path())
+	{
+		fs::current_path(dir);
+	}
+
+	~ScopedWorkingDirectory()
+	{
+		fs::current_path(previous);
+	}
+};
+
+/* Overrides a configuration setting for its lifetime */
+struct ScopedSetting
+{
+	ConfigMap previous;
+
+	ScopedSetting(const std::string& Key, const std::string& Value) : previous(Utilities::Config)
+	{
+		Utilities::Config[Key] = Value;
+	}
+
+	~ScopedSetting()
+	{
+		Utilities::Config = previous;
+	}
+};
+
 
 BOOST_AUTO_TEST_SUITE(UtilitiesTests)
 
@@ -57,6 +96,179 @@ BOOST_AUTO_TEST_CASE(HuffmanCodeLoading)
 	BOOST_REQUIRE(IsHuffmanCodeLoaded());
 }
 
+BOOST_AUTO_TEST_CASE(CodeTableLoading)
+{
+	/* A config directory with a code table converted from the shipped code, limited in length */
+	fs::path dir = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(dir / "config");
+	fs::copy_file("config/huffcode.map", dir / "config/huffcode.map");
+	Serialization::ConvertHuffmanCode("config/huffcode.map", (dir / "config/huffcode.bin").string(), 15);
+
+	HuffCodeMap loaded;
+	{
+		ScopedWorkingDirectory scope(dir);
+
+		UnloadHuffmanCode();
+		LoadHuffmanCode();
+		loaded = Utilities::HuffCode;
+	}
+
+	UnloadHuffmanCode();
+	LoadHuffmanCode();
+
+	/* The code table is preferred over the archived code */
+	BOOST_REQUIRE(loaded == Serialization::DeserializeCodeTable((dir / "config/huffcode.bin").string()));
+	BOOST_REQUIRE(loaded != Utilities::HuffCode);
+	fs::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(CompiledInCodeFallback)
+{
+	/* A config directory without code files */
+	fs::path dir = fs::temp_directory_path() / fs::unique_path();
+	fs::create_directories(dir / "config");
+
+	std::string text = "Without code files the compiled-in code is used.\n";
+	Data originalData(text.begin(), text.end());
+
+	bool bDefaultCode = false;
+	BackendList backends;
+	{
+		ScopedWorkingDirectory scope(dir);
+
+		UnloadHuffmanCode();
+		LoadHuffmanCode();
+		bDefaultCode = (Utilities::HuffCode == HuffmanCoding::DefaultCode());
+		backends = LoadCompressionBackends();
+	}
+
+	UnloadHuffmanCode();
+	LoadHuffmanCode();
+	fs::remove_all(dir);
+
+	BOOST_REQUIRE(bDefaultCode);
+	BOOST_REQUIRE(backends.size() == 2);
+
+	const CompressionBackend& huffman = Compression::FindBackend(backends, BACKEND_HUFFMAN);
+	BOOST_REQUIRE(huffman.Compress(originalData) == HuffmanCoding::DefaultEncoder().Encode(originalData));
+
+	for(BackendList::const_iterator it = backends.begin(); it != backends.end(); it++)
+	{
+		DataBits compData = Compression::Compress(originalData, **it);
+		BOOST_REQUIRE(Compression::Decompress(compData, backends) == originalData);
+	}
+
+	/* The loaded code has id 0 in the multi-code backend */
+	DataBits compData = Compression::FindBackend(backends, BACKEND_TABLES).Compress(originalData);
+	BitView view = compData;
+	BOOST_REQUIRE(view.Peek(0, MultiTableBackend::TableBits) == 0);
+	BOOST_REQUIRE(huffman.Decompress(view.Sub(MultiTableBackend::TableBits, view.size() - MultiTableBackend::TableBits)) == originalData);
+}
+
+BOOST_AUTO_TEST_CASE(MessageFormats)
+{
+	std::string text = "Messages are read in the format set apart from the writer.\n";
+	Data originalData(text.begin(), text.end());
+
+	BackendList backends = LoadCompressionBackends();
+	const CompressionBackend& huffman = Compression::FindBackend(backends, BACKEND_HUFFMAN);
+
+	/* Legacy messages are Huffman coded without a header */
+	DataBits legacyData;
+	{
+		ScopedSetting backend("Compression.Backend", "legacy");
+		legacyData = CompressMessage(originalData, backends);
+	}
+	BOOST_REQUIRE(legacyData == huffman.Compress(originalData));
+
+	/* Framed messages are written with the configured backend */
+	DataBits framedData;
+	{
+		ScopedSetting backend("Compression.Backend", "tables");
+		framedData = CompressMessage(originalData, backends);
+	}
+	BOOST_REQUIRE(framedData == Compression::Compress(originalData, Compression::FindBackend(backends, BACKEND_TABLES)));
+
+	/* The reader does not depend on the written backend */
+	const char* Writers[] = { "legacy", "huffman", "tables" };
+	for(size_t i = 0; i < sizeof(Writers) / sizeof(Writers[0]); i++)
+	{
+		ScopedSetting backend("Compression.Backend", Writers[i]);
+		{
+			ScopedSetting read("Compression.Read", "legacy");
+			BOOST_REQUIRE(DecompressMessage(legacyData, backends) == originalData);
+		}
+		{
+			ScopedSetting read("Compression.Read", "framed");
+			BOOST_REQUIRE(DecompressMessage(framedData, backends) == originalData);
+		}
+	}
+
+	/* Legacy is read when no format is set */
+	{
+		ConfigMap previous = Utilities::Config;
+		Utilities::Config.erase("Compression.Read");
+		Data uncompressedData = DecompressMessage(legacyData, backends);
+		Utilities::Config = previous;
+		BOOST_REQUIRE(uncompressedData == originalData);
+	}
+
+	ScopedSetting read("Compression.Read", "unknown");
+	BOOST_REQUIRE_THROW(DecompressMessage(framedData, backends), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(FileCompression)
+{
+	/* Text over several chunks, with characters outside of the alphabet */
+	std::string text;
+	for(unsigned int i = 0; text.size() < 3 * (1 << 16) + 100; i++)
+	{
+		text += "Line " + std::to_string(i) + " of the file, in MIXED case\r\n";
+		text += (char) (0x80 + i % 0x80);
+		text += '\t';
+	}
+
+	fs::path path = fs::temp_directory_path() / fs::unique_path();
+	{
+		fs::ofstream fileStream(path, std::ios::out | std::ios::binary);
+		fileStream.write(text.data(), text.size());
+	}
+
+	std::string filtered = text;
+	HuffmanCoding::TransformCharDomain(filtered);
+	BOOST_REQUIRE(filtered.size() < text.size());
+	Data filteredData(filtered.begin(), filtered.end());
+
+	BackendList backends = LoadCompressionBackends();
+
+	/* Huffman coded while reading, with and without header, and coded at once */
+	const char* Writers[] = { "legacy", "huffman", "tables" };
+	for(size_t i = 0; i < sizeof(Writers) / sizeof(Writers[0]); i++)
+	{
+		ScopedSetting backend("Compression.Backend", Writers[i]);
+
+		std::ostringstream echo;
+		CompressedFile compressedFile = CompressFile(path.string(), backends, echo);
+
+		BOOST_REQUIRE(compressedFile.nChars == filtered.size());
+		BOOST_REQUIRE(echo.str() == filtered);
+		BOOST_REQUIRE(compressedFile.bits == CompressMessage(filteredData, backends));
+	}
+
+	std::ostringstream echo;
+	{
+		ScopedSetting backend("Compression.Backend", "legacy");
+		BOOST_REQUIRE(CompressFile(path.string(), backends, echo).bits == Compression::FindBackend(backends, BACKEND_HUFFMAN).Compress(filteredData));
+	}
+
+	ScopedSetting backend("Compression.Backend", "tables");
+	DataBits compData = CompressFile(path.string(), backends, echo).bits;
+	BOOST_REQUIRE(compData == Compression::Compress(filteredData, Compression::FindBackend(backends, BACKEND_TABLES)));
+	BOOST_REQUIRE(Compression::Decompress(compData, backends) == filteredData);
+
+	fs::remove(path);
+}
+
 BOOST_AUTO_TEST_CASE(KeystoreLoading)
 {
 	BOOST_REQUIRE(IsKeystoreLoaded());
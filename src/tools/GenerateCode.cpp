@@ -0,0 +1,104 @@
+/**
+ * Code generator run at build time. Turns an archived Huffman code
+ * into the entries of a constant table, which the library compiles
+ * in as its default code.
+ *
+ * @author Krzysztof Okupski
+ * @version 1.0
+ */
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/bimap.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/map.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Same layout as HuffCodeMap, so that the archive reads alike */
+typedef boost::bimap<char, std::vector<bool> > CodeMap;
+
+/* HuffmanCoding::Encoder::MaxCodeBits, which is not included as the tool
+   builds ahead of the library; a longer code fails the build here instead
+   of the first use of the compiled-in code */
+static const unsigned int MaxCodeBits = 32;
+
+
+int main(int argc, char* argv[])
+{
+	if(argc != 3)
+	{
+		std::cerr << "Usage: " << argv[0] << " <huffcode.map> <output file>" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		std::ifstream ifs(argv[1]);
+		if(!ifs.good())
+		{
+			throw std::runtime_error(std::string("[GenerateCode] Failed to open input stream\nPath: ") + argv[1]);
+		}
+
+		CodeMap codes;
+		boost::archive::text_iarchive ia(ifs);
+		ia >> codes;
+
+		if(codes.empty())
+		{
+			throw std::runtime_error("[GenerateCode] Huffman code is empty");
+		}
+
+		/* Checked up front, so that no partial table is left behind */
+		for(CodeMap::left_const_iterator it = codes.left.begin(); it != codes.left.end(); it++)
+		{
+			if(it->second.empty())
+			{
+				throw std::runtime_error("[GenerateCode] Empty code");
+			}
+			if(it->second.size() > MaxCodeBits)
+			{
+				throw std::runtime_error("[GenerateCode] Code exceeds the maximum length");
+			}
+		}
+
+		std::ofstream ofs(argv[2]);
+		if(!ofs.good())
+		{
+			throw std::runtime_error(std::string("[GenerateCode] Failed to open output stream\nPath: ") + argv[2]);
+		}
+
+		ofs << "/* Generated from huffcode.map at build time, do not edit */" << std::endl;
+		ofs << std::hex << std::setfill('0');
+
+		/* Character, code length and code right-aligned in the lower bits */
+		for(CodeMap::left_const_iterator it = codes.left.begin(); it != codes.left.end(); it++)
+		{
+			const std::vector<bool>& code = it->second;
+			uint64_t bits = 0;
+			for(size_t i = 0; i < code.size(); i++)
+				bits = (bits << 1) | code[i];
+
+			ofs << "{0x" << std::setw(2) << (unsigned int) (unsigned char) it->first
+			    << ", " << std::dec << code.size() << std::hex
+			    << ", 0x" << std::setw(16) << bits << "ULL}," << std::endl;
+		}
+
+		if(!ofs.good())
+		{
+			throw std::runtime_error("[GenerateCode] Failed to write the table");
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}